@@ -0,0 +1,86 @@
+#ifndef LIBGRAPHLET_BATCH_HPP
+#define LIBGRAPHLET_BATCH_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <libgraphlet/PreparedSignature.hpp>
+#include <libgraphlet/Similarity.hpp>
+
+namespace libgraphlet {
+	/**
+	 * In-memory store of prepared signatures for many networks.
+	 * Each network is counted and prepared once and then shared by every
+	 * similarity job that refers to it. Adding and reading are
+	 * thread-safe; entries never move, so references stay valid while the
+	 * store lives.
+	 */
+	class SignatureStore {
+		public:
+			/**
+			 * Adds a network and returns its index. labels holds an optional
+			 * name for every node.
+			 */
+			size_t add(
+				const std::string &name,
+				PreparedSignature &&sig,
+				std::vector<std::string> labels = std::vector<std::string>()
+			);
+
+			size_t add(
+				const std::string &name,
+				const orca::Orca &orca,
+				std::vector<std::string> labels = std::vector<std::string>()
+			);
+
+			size_t size() const;
+			const std::string &name(size_t i) const { return entry(i).name; }
+			const PreparedSignature &signature(size_t i) const { return entry(i).sig; }
+			const std::vector<std::string> &labels(size_t i) const { return entry(i).labels; }
+
+		private:
+			struct Entry {
+				std::string name;
+				PreparedSignature sig;
+				std::vector<std::string> labels;
+			};
+
+			const Entry &entry(size_t i) const;
+
+			mutable std::mutex mutex;
+			std::vector<std::unique_ptr<Entry>> entries;
+	};
+
+	/**
+	 * Comparison of network a against network b of a store.
+	 */
+	struct BatchJob {
+		size_t a, b;
+	};
+
+	/**
+	 * Runs similarity jobs over a store on a pool of threads
+	 * (0 = all cores), one job per thread at a time.
+	 *
+	 * With k > 0 each job keeps the k best matches per node of a,
+	 * otherwise all pairs. Matches scoring below cutoff are dropped.
+	 * Rows of a are processed in blocks, and emit(job, matches) is called
+	 * with the matches of each block as soon as it is done, so memory is
+	 * bounded by a block rather than by a whole job. Blocks of one job
+	 * are emitted in order of rows, but blocks of different jobs
+	 * interleave. Calls are serialized, so emit may write to a shared
+	 * stream.
+	 */
+	void similarity_batch(
+		const SignatureStore &store,
+		const std::vector<BatchJob> &jobs,
+		size_t k,
+		float cutoff,
+		const std::function<void(size_t, std::vector<Match>&)> &emit,
+		unsigned int threads = 0
+	);
+}
+
+#endif
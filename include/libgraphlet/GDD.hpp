@@ -3,22 +3,136 @@
 
 #include <vector>
 #include <map>
+#include <cstdint>
 #include <orca/Orca.hpp>
+#include <orca/GDVFile.hpp>
 
 namespace libgraphlet {
 	typedef std::vector<std::map<size_t, float>> GDD;
 
-	void gdd(
+	/**
+	 * Exact integer histogram of the degrees of one orbit.
+	 * dense[k] counts nodes of degree k for small k (dense[0] is unused,
+	 * nodes of degree 0 are not counted). Larger degrees are kept in tail
+	 * as (degree, count) pairs sorted by degree.
+	 */
+	struct OrbitHistogram {
+		std::vector<uint64_t> dense;
+		std::vector<std::pair<uint64_t, uint64_t>> tail;
+
+		/**
+		 * Calls f(degree, count) for every nonzero count in order of
+		 * increasing degree.
+		 */
+		template<typename F>
+		void for_each(F f) const {
+			for(size_t k = 1; k < dense.size(); ++k) {
+				if(dense[k] > 0) f((uint64_t)k, dense[k]);
+			}
+			for(auto &p : tail) f(p.first, p.second);
+		}
+	};
+
+	typedef std::vector<OrbitHistogram> GDDHistogram;
+
+	/**
+	 * Distribution of one orbit as (degree, value) pairs sorted by degree.
+	 */
+	typedef std::vector<std::vector<std::pair<uint64_t, float>>> SparseGDD;
+
+	/**
+	 * Counts orbit degrees into per-orbit histograms. Nodes are split
+	 * between the given number of threads (0 = all cores), each filling
+	 * its own histograms, which are merged afterwards.
+	 */
+	void gdd_histogram(
 		const orca::Orca &orca,
+		GDDHistogram &hist,
+		unsigned int threads = 0
+	);
+
+	void gdd_histogram(
+		const orca::GDVFile &file,
+		GDDHistogram &hist,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Histograms of n row-major GDVs of the given number of orbits, with
+	 * consecutive rows row_stride elements apart.
+	 */
+	void gdd_histogram(
+		const int64_t *data,
+		size_t n,
+		size_t orbits,
+		size_t row_stride,
+		GDDHistogram &hist,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Counts the orbits of orca and their degree histograms in one pass
+	 * without storing the signature: every node's counts go straight into
+	 * per-thread histograms (see Orca::compute(const OrbitSink&)), so
+	 * memory depends on the number of distinct degrees rather than on
+	 * n x orbits. orca must not have been computed; its signature is
+	 * empty afterwards. Threads are those set on orca.
+	 */
+	void count_gdd_histogram(
+		orca::Orca &orca,
+		GDDHistogram &hist
+	);
+
+	/**
+	 * Converts histograms to distributions, optionally scaled by 1/k and
+	 * normalized to sum to one.
+	 */
+	void gdd(
+		const GDDHistogram &hist,
+		SparseGDD &gdd,
+		bool normalize = true
+	);
+
+	void gdd(
+		const GDDHistogram &hist,
 		GDD &gdd,
 		bool normalize = true
 	);
 
+	void gdd(
+		const orca::Orca &orca,
+		GDD &gdd,
+		bool normalize = true,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Calculates the GDD-agreement of every orbit of two normalized
+	 * GDDs. The sorted distributions are merged, so the cost is linear in
+	 * the number of distinct degrees rather than the largest degree.
+	 */
 	void gdd_agreement(
 		const GDD &a,
 		const GDD &b,
 		std::vector<float> &out
 	);
+
+	void gdd_agreement(
+		const SparseGDD &a,
+		const SparseGDD &b,
+		std::vector<float> &out
+	);
+
+	/**
+	 * Fills the symmetric N x N matrix of mean GDD-agreement between every
+	 * pair of normalized GDDs. Rows are computed in parallel by the given
+	 * number of threads (0 = all cores).
+	 */
+	void gdd_agreement_matrix(
+		const std::vector<SparseGDD> &gdds,
+		boost::numeric::ublas::matrix<float> &out,
+		unsigned int threads = 0
+	);
 }
 
 #endif
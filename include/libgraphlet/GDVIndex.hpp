@@ -0,0 +1,82 @@
+#ifndef LIBGRAPHLET_GDVINDEX_HPP
+#define LIBGRAPHLET_GDVINDEX_HPP
+
+#include <vector>
+#include <random>
+#include <libgraphlet/PreparedSignature.hpp>
+#include <libgraphlet/Similarity.hpp>
+
+namespace libgraphlet {
+	/**
+	 * Approximate nearest neighbour index over the GDVs of a network.
+	 *
+	 * The index is a forest of random projection trees built in weighted
+	 * log orbit space. Each split is the hyperplane halfway between two
+	 * randomly chosen nodes. Queries descend all trees at once, visiting
+	 * the branches closest to the query first, until search_k distinct
+	 * candidates have been collected. Candidates are then ranked by the exact GDV
+	 * similarity. Larger search_k gives higher recall at higher cost.
+	 *
+	 * The index refers to the signature it was built from, which must
+	 * outlive it.
+	 */
+	class GDVIndex {
+		public:
+			GDVIndex(
+				const PreparedSignature &sig,
+				size_t trees = 10,
+				size_t leaf_size = 32,
+				unsigned int seed = 1
+			);
+
+			/**
+			 * Finds the k most similar indexed nodes for node i of q.
+			 * At least max(search_k, k) distinct candidates are examined;
+			 * search_k = 0 examines k * trees. Exactly min(k, size())
+			 * matches are returned, ordered by decreasing score.
+			 */
+			void query(
+				const PreparedSignature &q,
+				size_t i,
+				size_t k,
+				std::vector<Match> &out,
+				size_t search_k = 0
+			) const;
+
+			/**
+			 * Queries every node of q in parallel. Every node gets exactly
+			 * min(k, size()) matches, ordered by node of q, then by
+			 * decreasing score.
+			 */
+			void query(
+				const PreparedSignature &q,
+				size_t k,
+				std::vector<Match> &out,
+				size_t search_k = 0,
+				unsigned int threads = 0
+			) const;
+
+			size_t size() const { return sig.size(); }
+
+		private:
+			struct Node {
+				bool leaf;
+				size_t begin, end;   // leaf: range in items
+				size_t left, right;  // split: child nodes
+				size_t normal;       // split: offset in normals
+				float offset;
+			};
+
+			size_t build(size_t begin, size_t end, std::mt19937 &rng);
+			float margin(const Node &node, const PreparedSignature &q, size_t i) const;
+
+			const PreparedSignature &sig;
+			size_t leaf_size;
+			std::vector<Node> nodes;
+			std::vector<size_t> roots;
+			std::vector<size_t> items;
+			std::vector<float> normals;
+	};
+}
+
+#endif
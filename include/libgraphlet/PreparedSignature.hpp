@@ -0,0 +1,134 @@
+#ifndef LIBGRAPHLET_PREPAREDSIGNATURE_HPP
+#define LIBGRAPHLET_PREPAREDSIGNATURE_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <orca/Orca.hpp>
+#include <orca/GDVFile.hpp>
+
+namespace libgraphlet {
+	/**
+	 * GDVs of a network transformed once for similarity computations.
+	 *
+	 * For every node i and orbit k it holds log(x+1) and 1/log(x+2) of the
+	 * orbit count x, along with the orbit weights. Since log is monotonic,
+	 * 1/log(max(a,b)+2) = min(1/log(a+2), 1/log(b+2)), so the distance
+	 * between two nodes needs no transcendental calls.
+	 *
+	 * Rows are contiguous and padded to a multiple of LANES orbits. Padded
+	 * entries have zero weight and contribute nothing. Orbits are stored
+	 * in order of decreasing weight, so partial sums over the first columns
+	 * cover the heaviest orbits. Column 0 always holds orbit 0 (degree).
+	 */
+	class PreparedSignature {
+		public:
+			static const size_t LANES = 8;
+
+			explicit PreparedSignature(const orca::Orca &orca);
+			explicit PreparedSignature(const orca::GDVFile &file);
+
+			/**
+			 * Prepares n row-major GDVs of the given number of orbits,
+			 * with consecutive rows row_stride elements apart.
+			 */
+			PreparedSignature(
+				const int64_t *data,
+				size_t n,
+				size_t orbits,
+				size_t row_stride
+			);
+
+			size_t size() const { return n; }
+			size_t orbits() const { return orbit_count; }
+			size_t stride() const { return row_stride; }
+
+			const float *logs(size_t i) const { return log1.data() + i*row_stride; }
+			const float *invLogs(size_t i) const { return inv2.data() + i*row_stride; }
+			const float *weights() const { return w.data(); }
+			float weightsSum() const { return w_sum; }
+
+			/**
+			 * Orbit stored in the given column.
+			 */
+			size_t orbit(size_t column) const { return order[column]; }
+
+		private:
+			void prepare(const int64_t *data, size_t row_stride_in);
+
+			size_t n, orbit_count, row_stride;
+			std::vector<float> log1, inv2, w;
+			std::vector<size_t> order;
+			float w_sum;
+	};
+
+	/**
+	 * Weighted GDV distance between node i of a and node j of b.
+	 * Accumulates LANES independent sums so the loop vectorizes.
+	 */
+	inline float distance(
+		const PreparedSignature &a, size_t i,
+		const PreparedSignature &b, size_t j
+	) {
+		const size_t L = PreparedSignature::LANES;
+		const size_t stride = a.stride();
+		const float *a1 = a.logs(i), *a2 = a.invLogs(i);
+		const float *b1 = b.logs(j), *b2 = b.invLogs(j);
+		const float *w = a.weights();
+
+		float acc[L] = { 0.0f };
+		for(size_t k = 0; k < stride; k += L) {
+			for(size_t l = 0; l < L; ++l) {
+				float num = std::fabs(a1[k+l] - b1[k+l]);
+				acc[l] += w[k+l] * num * std::min(a2[k+l], b2[k+l]);
+			}
+		}
+		float D = 0.0f;
+		for(size_t l = 0; l < L; ++l) D += acc[l];
+		return D;
+	}
+
+	/**
+	 * Like distance(), but stops once the partial distance exceeds bound.
+	 * The partial sum is checked after every LANES orbits, heaviest first.
+	 * Returns the exact distance if it is at most bound, otherwise some
+	 * value greater than bound.
+	 */
+	inline float distance_bounded(
+		const PreparedSignature &a, size_t i,
+		const PreparedSignature &b, size_t j,
+		float bound
+	) {
+		const size_t L = PreparedSignature::LANES;
+		const size_t stride = a.stride();
+		const float *a1 = a.logs(i), *a2 = a.invLogs(i);
+		const float *b1 = b.logs(j), *b2 = b.invLogs(j);
+		const float *w = a.weights();
+
+		float acc[L] = { 0.0f };
+		for(size_t k = 0; k < stride; k += L) {
+			for(size_t l = 0; l < L; ++l) {
+				float num = std::fabs(a1[k+l] - b1[k+l]);
+				acc[l] += w[k+l] * num * std::min(a2[k+l], b2[k+l]);
+			}
+			float D = 0.0f;
+			for(size_t l = 0; l < L; ++l) D += acc[l];
+			if(D > bound) return D;
+		}
+		float D = 0.0f;
+		for(size_t l = 0; l < L; ++l) D += acc[l];
+		return D;
+	}
+
+	/**
+	 * GDV similarity between node i of a and node j of b.
+	 */
+	inline float similarity(
+		const PreparedSignature &a, size_t i,
+		const PreparedSignature &b, size_t j
+	) {
+		return 1.0f - distance(a, i, b, j) / a.weightsSum();
+	}
+}
+
+#endif
@@ -3,12 +3,197 @@
 
 #include <vector>
 #include <orca/Orca.hpp>
+#include <libgraphlet/PreparedSignature.hpp>
+#include <libgraphlet/QuantizedSignature.hpp>
 
 namespace libgraphlet {
+	/**
+	 * Similarity score of node i in the first network and node j in the second.
+	 */
+	struct Match {
+		size_t i, j;
+		float score;
+	};
+
+	/**
+	 * Computes the GDV similarity of every node in oa to every node in ob.
+	 * The work is split into tiles processed by the given number of
+	 * threads (0 = all cores). Passing the same instance twice computes
+	 * only the upper triangle.
+	 */
 	void similarity(
 		const orca::Orca &oa,
 		const orca::Orca &ob,
-		boost::numeric::ublas::matrix<float> &sim
+		boost::numeric::ublas::matrix<float> &sim,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Computes the similarity matrix from prepared signatures, which can
+	 * be reused across calls. If a and b are the same object only the
+	 * upper triangle is computed and mirrored.
+	 */
+	void similarity(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		boost::numeric::ublas::matrix<float> &sim,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Finds the k most similar nodes in b for every node in a without
+	 * materializing the full matrix. Each row keeps a bounded heap while
+	 * tiles of b are streamed through it, so memory use is O(na * k).
+	 * Matches are ordered by i, then by decreasing score (ties by j).
+	 */
+	void similarity_topk(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		size_t k,
+		std::vector<Match> &out,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Finds all pairs with similarity at least cutoff.
+	 * Candidate pairs are pruned with lower bounds on the distance: nodes
+	 * of b are sorted by degree so only a window around each node of a is
+	 * visited, and distances are abandoned once the partial sum over the
+	 * heaviest orbits exceeds the bound. Matches are ordered by i.
+	 * Pruning pays off when the cutoff keeps a small fraction of pairs;
+	 * for dense results the full matrix is faster.
+	 */
+	void similarity_threshold(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		float cutoff,
+		std::vector<Match> &out,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Computes the similarity of an explicit list of pairs, filling in
+	 * the score of each match in place. Pairs are visited in order of
+	 * (i, j) so rows of both signatures are reused from cache, and the
+	 * list is split between the given number of threads. The order of
+	 * pairs is preserved.
+	 */
+	void similarity_pairs(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		std::vector<Match> &pairs,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Position of pair (i, j), i < j, in a packed upper triangle of an
+	 * n x n matrix without the diagonal.
+	 */
+	inline size_t triangle_index(size_t n, size_t i, size_t j) {
+		return i*n - i*(i+1)/2 + (j - i - 1);
+	}
+
+	/**
+	 * Computes the GDV similarity of every pair of nodes within one
+	 * network. Only pairs i < j are computed and stored, packed row by
+	 * row as given by triangle_index(), so sim has n(n-1)/2 entries.
+	 * The diagonal is always 1.
+	 */
+	void similarity(
+		const orca::Orca &o,
+		std::vector<float> &sim,
+		unsigned int threads = 0
+	);
+
+	void similarity(
+		const PreparedSignature &a,
+		std::vector<float> &sim,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Finds all pairs i < j within one network with similarity at least
+	 * cutoff. Matches are ordered by i.
+	 */
+	void similarity_threshold(
+		const PreparedSignature &a,
+		float cutoff,
+		std::vector<Match> &out,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Similarity matrix, top-k matches and pair scores computed on quantized
+	 * signatures. Scores differ from the float versions by at most the
+	 * bound documented in QuantizedSignature.
+	 */
+	void similarity(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		boost::numeric::ublas::matrix<float> &sim,
+		unsigned int threads = 0
+	);
+
+	void similarity_topk(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		size_t k,
+		std::vector<Match> &out,
+		unsigned int threads = 0
+	);
+
+	void similarity_pairs(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		std::vector<Match> &pairs,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Computes rows begin to end (exclusive) of the similarity matrix
+	 * into out, which must hold (end - begin) * b.size() values.
+	 * Lets callers produce the matrix in blocks of bounded size.
+	 */
+	void similarity_rows(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		size_t begin,
+		size_t end,
+		float *out,
+		unsigned int threads = 0
+	);
+
+	void similarity_rows(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		size_t begin,
+		size_t end,
+		float *out,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * similarity_topk and similarity_threshold restricted to rows begin
+	 * to end (exclusive) of a, so results can be produced in blocks.
+	 */
+	void similarity_topk_rows(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		size_t begin,
+		size_t end,
+		size_t k,
+		std::vector<Match> &out,
+		unsigned int threads = 0
+	);
+
+	void similarity_threshold_rows(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		size_t begin,
+		size_t end,
+		float cutoff,
+		std::vector<Match> &out,
+		unsigned int threads = 0
 	);
 }
 
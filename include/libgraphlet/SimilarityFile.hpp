@@ -0,0 +1,76 @@
+#ifndef LIBGRAPHLET_SIMILARITYFILE_HPP
+#define LIBGRAPHLET_SIMILARITYFILE_HPP
+
+#include <string>
+#include <cstdint>
+#include <libgraphlet/PreparedSignature.hpp>
+#include <libgraphlet/QuantizedSignature.hpp>
+
+namespace libgraphlet {
+	/**
+	 * Binary similarity matrix file.
+	 *
+	 * A 64 byte header followed by rows * cols 32-bit floats in native
+	 * byte order, row-major. The header holds the magic "LGSIMMAT", a
+	 * format version, the header size and the matrix dimensions.
+	 */
+	struct SimilarityFileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t header_size;
+		uint64_t rows;
+		uint64_t cols;
+		char reserved[32];
+	};
+
+	/**
+	 * Computes the similarity matrix of a and b in blocks of block_rows
+	 * rows and writes it to a binary file without materializing the full
+	 * matrix. Two blocks are kept in memory: while one is written by a
+	 * background thread the next is computed into the other.
+	 * Throws std::runtime_error if the file cannot be written.
+	 */
+	void similarity_file(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		const std::string &path,
+		size_t block_rows = 1024,
+		unsigned int threads = 0
+	);
+
+	void similarity_file(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		const std::string &path,
+		size_t block_rows = 1024,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Read-only memory-mapped view of a binary similarity matrix file.
+	 * Rows are paged in on access, so arbitrarily large matrices can be
+	 * read with random row access.
+	 */
+	class SimilarityFile {
+		public:
+			explicit SimilarityFile(const std::string &path);
+			~SimilarityFile();
+
+			SimilarityFile(const SimilarityFile&) = delete;
+			SimilarityFile &operator=(const SimilarityFile&) = delete;
+
+			size_t rows() const { return n_rows; }
+			size_t cols() const { return n_cols; }
+
+			const float *row(size_t i) const { return data + i*n_cols; }
+			float operator()(size_t i, size_t j) const { return data[i*n_cols + j]; }
+
+		private:
+			void *map;
+			size_t map_size;
+			size_t n_rows, n_cols;
+			const float *data;
+	};
+}
+
+#endif
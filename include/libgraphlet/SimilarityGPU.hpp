@@ -5,14 +5,84 @@
 #include <boost/compute/core.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <orca/Orca.hpp>
+#include <libgraphlet/PreparedSignature.hpp>
 
 namespace libgraphlet {
+	/**
+	 * Persistent OpenCL similarity engine.
+	 *
+	 * The context, built program, command queues and device buffers are
+	 * created once and reused by every call. Matrices are computed in
+	 * tiles of at most tile_rows x tile_cols entries, shrunk if needed to
+	 * fit device memory, so na * nb is not limited by the device.
+	 *
+	 * Two tile slots are used in turn, each with its own queue and
+	 * buffers. While one slot computes a tile, the other uploads its rows
+	 * of a and reads back its finished tile. Any OpenCL 1.1 device works,
+	 * including CPU runtimes such as POCL.
+	 */
+	class SimilarityEngine {
+		public:
+			explicit SimilarityEngine(
+				const boost::compute::device &device = boost::compute::system::default_device(),
+				size_t tile_rows = 1024,
+				size_t tile_cols = 8192
+			);
+
+			void similarity(
+				const PreparedSignature &a,
+				const PreparedSignature &b,
+				boost::numeric::ublas::matrix<float> &sim
+			);
+
+			/**
+			 * Computes the matrix into out, row-major with b.size() columns.
+			 */
+			void similarity(
+				const PreparedSignature &a,
+				const PreparedSignature &b,
+				float *out
+			);
+
+			const boost::compute::device &device() const { return dev; }
+
+		private:
+			struct Slot {
+				boost::compute::command_queue queue;
+				boost::compute::kernel kernel;
+				boost::compute::buffer a_log, a_inv, sim;
+				std::vector<float> host;
+				boost::compute::event done;
+				size_t i0, i1, j0, j1;
+				bool pending;
+			};
+
+			void reserve(size_t stride);
+			void finish(Slot &slot, float *out, size_t nb);
+
+			boost::compute::device dev;
+			boost::compute::context context;
+			boost::compute::program program;
+			size_t tile_rows, tile_cols;
+
+			size_t buffer_stride;
+			boost::compute::buffer weights, b_log, b_inv;
+			Slot slots[2];
+	};
+
 	void similarityGPU(
 		const orca::Orca &oa,
 		const orca::Orca &ob,
 		boost::numeric::ublas::matrix<float> &sim,
 		const boost::compute::device &device = boost::compute::system::default_device()
 	);
+
+	void similarityGPU(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		boost::numeric::ublas::matrix<float> &sim,
+		const boost::compute::device &device = boost::compute::system::default_device()
+	);
 }
 
 #endif
@@ -0,0 +1,86 @@
+#ifndef ORCA_CSR_HPP
+#define ORCA_CSR_HPP
+
+#include <cstddef>
+#include <utility>
+
+namespace orca {
+	/**
+	 * Read-only view of a contiguous range of elements.
+	 */
+	template<typename T>
+	class Row {
+		public:
+			Row(const T *first, const T *last) : first(first), last(last) { }
+
+			const T &operator[](size_t i) const { return first[i]; }
+			const T *begin() const { return first; }
+			const T *end() const { return last; }
+			size_t size() const { return last - first; }
+
+		private:
+			const T *first, *last;
+	};
+
+	/**
+	 * Non-owning view of an undirected graph in compressed sparse row form.
+	 *
+	 * The neighbours of node x are neighbours[offsets[x]] up to
+	 * neighbours[offsets[x+1]]. Every edge must be stored in both directions,
+	 * each row must be sorted in ascending order and free of duplicates and
+	 * self-loops. The memory must outlive any Orca instance built from it.
+	 */
+	class CSR {
+		public:
+			CSR() : n(0), offsets(nullptr), neighbours(nullptr) { }
+
+			CSR(size_t n, const size_t *offsets, const int *neighbours)
+			: n(n), offsets(offsets), neighbours(neighbours) { }
+
+			Row<int> operator[](size_t x) const {
+				return Row<int>(neighbours + offsets[x], neighbours + offsets[x+1]);
+			}
+
+			size_t nodes() const { return n; }
+			size_t edges() const { return (n > 0 ? offsets[n] / 2 : 0); }
+
+			size_t n;
+			const size_t *offsets;
+			const int *neighbours;
+	};
+
+	/**
+	 * Incidence lists on top of a CSR view. Entry i of row x is the pair
+	 * (neighbour, edge id) for the i'th neighbour of x.
+	 */
+	class Incidence {
+		public:
+			class IncidenceRow {
+				public:
+					IncidenceRow(const int *neighbours, const int *ids)
+					: neighbours(neighbours), ids(ids) { }
+
+					std::pair<int,int> operator[](size_t i) const {
+						return std::pair<int,int>(neighbours[i], ids[i]);
+					}
+
+				private:
+					const int *neighbours;
+					const int *ids;
+			};
+
+			Incidence() : ids(nullptr) { }
+			Incidence(const CSR &adj, const int *ids) : adj(adj), ids(ids) { }
+
+			IncidenceRow operator[](size_t x) const {
+				size_t o = adj.offsets[x];
+				return IncidenceRow(adj.neighbours + o, ids + o);
+			}
+
+		private:
+			CSR adj;
+			const int *ids;
+	};
+}
+
+#endif
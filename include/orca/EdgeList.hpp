@@ -0,0 +1,51 @@
+#ifndef ORCA_EDGELIST_HPP
+#define ORCA_EDGELIST_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace orca {
+	/**
+	 * Simple undirected graph loaded from an edge list.
+	 * Nodes are numbered in order of first appearance and labels[i] is the
+	 * name of node i. Edges are given as (a,b) with a < b, sorted and
+	 * without duplicates or self-loops, so they can be passed to Orca
+	 * with sorted set.
+	 */
+	struct EdgeList {
+		std::vector<std::string> labels;
+		std::vector<std::pair<size_t,size_t>> edges;
+
+		size_t nodes() const { return labels.size(); }
+	};
+
+	/**
+	 * Parses an edge list from memory. Every line holds two node labels
+	 * separated by spaces or tabs; further columns are ignored. Empty
+	 * lines and lines starting with # are skipped.
+	 *
+	 * The input is split at line boundaries and parsed by the given number
+	 * of threads (0 = all cores). Labels are interned per part in hash
+	 * tables, numbered globally in part order, and edges are deduplicated
+	 * by sorting. Throws std::invalid_argument on a line with one column.
+	 */
+	void parse_edge_list(
+		const char *data,
+		size_t size,
+		EdgeList &out,
+		unsigned int threads = 0
+	);
+
+	/**
+	 * Memory-maps the file at path and parses it with parse_edge_list.
+	 * Throws std::runtime_error if the file cannot be read.
+	 */
+	void read_edge_list(
+		const std::string &path,
+		EdgeList &out,
+		unsigned int threads = 0
+	);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef ORCA_ESTIMATE_HPP
+#define ORCA_ESTIMATE_HPP
+
+#include <vector>
+#include <utility>
+#include <orca/CSR.hpp>
+
+namespace orca {
+	/**
+	 * Predicted cost of running Orca::compute() on a graph.
+	 * All values are model estimates derived from the degree sequence
+	 * and a sampled triangle count, not measurements.
+	 */
+	struct CostEstimate {
+		size_t nodes;
+		size_t edges;
+		double wedges;           // exact number of paths of length 2
+		double triangles;        // estimated by wedge sampling
+
+		double work;             // inner loop steps of compute()
+		double common2_entries;  // entries in the common2 table (size 5 only)
+		double common3_entries;  // entries in the common3 table (size 5 only)
+		double two_hop_entries;  // two-hop counts of all nodes (size 5 only)
+
+		size_t memory_graph;     // degrees, adjacency and edge ids
+		size_t memory_orbits;    // orbit count matrix
+		size_t memory_common;    // common2 and common3 tables that fit the budget
+		size_t memory_temp;      // scratch vectors and two-hop cache
+		size_t memory_peak;
+
+		double seconds;          // expected wall time with the given threads
+	};
+
+	/**
+	 * Estimates the cost of counting graphlets of the given size.
+	 * samples is the number of wedges sampled to estimate the triangle count.
+	 * ns_per_step is the assumed time for a single inner loop step and
+	 * should be calibrated for the target machine. threads, memory_budget
+	 * and cache_budget are the settings of the Orca run being estimated
+	 * (see Orca::setThreads, setMemoryBudget and setCacheBudget).
+	 */
+	CostEstimate estimate(
+		const CSR &graph,
+		unsigned int graphlet_size,
+		size_t samples = 100000,
+		double ns_per_step = 2.0,
+		unsigned int threads = 1,
+		size_t memory_budget = 0,
+		size_t cache_budget = 256 << 20
+	);
+
+	CostEstimate estimate(
+		size_t n,
+		const std::vector<std::pair<size_t,size_t>> &edges,
+		unsigned int graphlet_size,
+		size_t samples = 100000,
+		double ns_per_step = 2.0,
+		unsigned int threads = 1,
+		size_t memory_budget = 0,
+		size_t cache_budget = 256 << 20
+	);
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef ORCA_GDVFILE_HPP
+#define ORCA_GDVFILE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <orca/Orca.hpp>
+
+namespace orca {
+	/**
+	 * Binary GDV file.
+	 *
+	 * A 128 byte header, the orbit counts and optionally node labels, all
+	 * in native byte order. Counts are nodes rows of row_stride int64
+	 * values starting at data_offset, which is page aligned. Rows are
+	 * padded with zeros to a multiple of 8 values, so every row starts on
+	 * a 64 byte boundary. If labels_offset is nonzero the label section
+	 * holds nodes+1 uint64 offsets followed by the label characters;
+	 * label i spans offsets [i, i+1) of the characters.
+	 *
+	 * key is Orca::key() of the counted graph and checksum a hash of the
+	 * row payload, padding included; either is zero if unknown.
+	 */
+	struct GDVFileHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t header_size;
+		uint32_t graphlet_size;
+		uint32_t orbits;
+		uint64_t nodes;
+		uint64_t row_stride;
+		uint64_t data_offset;
+		uint64_t labels_offset;
+		uint64_t labels_size;
+		uint64_t key_hi;
+		uint64_t key_lo;
+		uint64_t checksum;
+		char reserved[40];
+	};
+
+	/**
+	 * Writes the orbit counts of a computed Orca instance to a binary GDV
+	 * file. labels is either empty or holds the name of every node.
+	 * Throws std::runtime_error if the file cannot be written.
+	 */
+	void write_gdv_file(
+		const std::string &path,
+		const Orca &orca,
+		const std::vector<std::string> &labels = std::vector<std::string>()
+	);
+
+	/**
+	 * As above, with the key already computed by orca.key().
+	 */
+	void write_gdv_file(
+		const std::string &path,
+		const Orca &orca,
+		const GraphKey &key,
+		const std::vector<std::string> &labels = std::vector<std::string>()
+	);
+
+	/**
+	 * True if the file at path starts with the GDV file magic.
+	 */
+	bool is_gdv_file(const std::string &path);
+
+	/**
+	 * Read-only memory-mapped view of a binary GDV file. Counts are used
+	 * in place without parsing or copying, and pages are read on access.
+	 */
+	class GDVFile {
+		public:
+			explicit GDVFile(const std::string &path);
+			~GDVFile();
+
+			GDVFile(const GDVFile&) = delete;
+			GDVFile &operator=(const GDVFile&) = delete;
+
+			size_t size() const { return n; }
+			size_t orbits() const { return orbit_count; }
+			size_t stride() const { return row_stride; }
+			int graphletSize() const { return graphlet_size; }
+
+			const int64_t *data() const { return counts; }
+			const int64_t *row(size_t i) const { return counts + i*row_stride; }
+			int64_t operator()(size_t i, size_t k) const { return counts[i*row_stride + k]; }
+
+			GraphKey key() const;
+
+			/**
+			 * Recomputes the payload checksum and compares it to the one
+			 * stored in the header. Files without a checksum fail.
+			 */
+			bool verify() const;
+
+			bool hasLabels() const { return label_offsets != nullptr; }
+			std::string label(size_t i) const;
+
+			/**
+			 * Labels of all nodes, or empty if the file has none.
+			 */
+			std::vector<std::string> labels() const;
+
+		private:
+			const GDVFileHeader &header() const { return *(const GDVFileHeader*)map; }
+
+			void *map;
+			size_t map_size;
+			size_t n, orbit_count, row_stride;
+			int graphlet_size;
+			const int64_t *counts;
+			const uint64_t *label_offsets;
+			const char *label_chars;
+	};
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef ORCA_HASH_HPP
+#define ORCA_HASH_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+namespace orca {
+	/**
+	 * Streaming 64-bit hash of 64-bit words. Words are spread over four
+	 * lanes in turn, using the round and final mix of xxHash64, so long
+	 * inputs hash at close to memory speed. Not cryptographic.
+	 */
+	class Hasher {
+		public:
+			explicit Hasher(uint64_t seed = 0) : count(0) {
+				lanes[0] = seed + P1 + P2;
+				lanes[1] = seed + P2;
+				lanes[2] = seed;
+				lanes[3] = seed - P1;
+			}
+
+			void add(uint64_t v) {
+				uint64_t &l = lanes[count++ & 3];
+				l = rotl(l + v * P2, 31) * P1;
+			}
+
+			void add(const int64_t *data, size_t n) {
+				for(size_t i = 0; i < n; ++i) add((uint64_t)data[i]);
+			}
+
+			uint64_t digest() const {
+				uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+				h ^= count * P1;
+				h ^= h >> 33;
+				h *= P2;
+				h ^= h >> 29;
+				h *= P3;
+				h ^= h >> 32;
+				return h;
+			}
+
+		private:
+			static const uint64_t P1 = 11400714785074694791ULL;
+			static const uint64_t P2 = 14029467366897019727ULL;
+			static const uint64_t P3 = 1609587929392839161ULL;
+
+			static uint64_t rotl(uint64_t x, int r) {
+				return (x << r) | (x >> (64 - r));
+			}
+
+			uint64_t lanes[4];
+			uint64_t count;
+	};
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef ORCA_ORBITCACHE_HPP
+#define ORCA_ORBITCACHE_HPP
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <orca/Orca.hpp>
+#include <orca/GDVFile.hpp>
+
+namespace orca {
+	/**
+	 * On-disk cache of orbit counts keyed by Orca::key().
+	 *
+	 * Every entry is a binary GDV file named by its key in one
+	 * directory. Entries are written under a temporary name and
+	 * renamed, so processes sharing the directory never see partial
+	 * files. Reads check the key, shape and payload checksum, and
+	 * corrupt entries are deleted. With a size limit the least recently
+	 * used entries are evicted after each store, never the entry just
+	 * stored. All methods may be called from several threads.
+	 */
+	class OrbitCache {
+		public:
+			/**
+			 * Uses dir, creating it if needed. max_bytes limits the total
+			 * size of the entries (0 = unlimited). Throws
+			 * std::runtime_error if dir cannot be created.
+			 */
+			explicit OrbitCache(const std::string &dir, uint64_t max_bytes = 0);
+
+			/**
+			 * Maps the entry for key, or returns null if there is no valid
+			 * entry of the given shape.
+			 */
+			std::unique_ptr<GDVFile> open(const GraphKey &key, size_t nodes, int graphlet_size) const;
+
+			/**
+			 * Stores the counts of a computed Orca instance under key,
+			 * which must be orca.key(). Failures only leave the entry
+			 * missing; returns false in that case.
+			 */
+			bool store(const Orca &orca, const GraphKey &key) const;
+
+			std::string path(const GraphKey &key) const;
+			const std::string &directory() const { return dir; }
+
+		private:
+			/**
+			 * Deletes least recently used entries other than keep until
+			 * the limit is met, and temporary files of crashed writers.
+			 */
+			void evict(const std::string &keep) const;
+
+			std::string dir;
+			uint64_t max_bytes;
+	};
+}
+
+#endif
@@ -1,9 +1,14 @@
 #ifndef ORCA_ORCA_HPP
 #define ORCA_ORCA_HPP
 
+#include <algorithm>
 #include <unordered_map>
 #include <utility>
+#include <functional>
+#include <string>
+#include <cstdint>
 #include <boost/numeric/ublas/matrix.hpp>
+#include <orca/CSR.hpp>
 #include <orca/Pair.hpp>
 #include <orca/Triple.hpp>
 
@@ -12,6 +17,47 @@ namespace orca {
 
 	unsigned const int ORBITS[6] = { 0, 0, 1, 4, 15, 73 };
 
+	class OrbitCache;
+
+	/**
+	 * 128-bit content key of a graph and graphlet size.
+	 */
+	struct GraphKey {
+		uint64_t hi, lo;
+
+		bool operator==(const GraphKey &k) const { return hi == k.hi && lo == k.lo; }
+		bool operator!=(const GraphKey &k) const { return !(*this == k); }
+
+		/**
+		 * 32 digit hexadecimal representation.
+		 */
+		std::string hex() const;
+	};
+
+	/**
+	 * Receives the finished orbit counts of one node. worker identifies
+	 * the calling thread (below Orca::workers()); calls with different
+	 * workers may run concurrently. The row is only valid during the call.
+	 */
+	typedef std::function<void(unsigned int worker, size_t node, const int64_t *orbits)> OrbitSink;
+
+	/**
+	 * Bytes held by each of the data structures of an Orca instance.
+	 * Memory borrowed from the caller (CSR views) is not included.
+	 */
+	struct MemoryUsage {
+		size_t degrees;
+		size_t adjacency;
+		size_t edge_ids;
+		size_t orbits;
+		size_t common2;
+		size_t common3;
+
+		size_t total() const {
+			return degrees + adjacency + edge_ids + orbits + common2 + common3;
+		}
+	};
+
 	class Orca {
 		public:
 			Orca(
@@ -19,11 +65,126 @@ namespace orca {
 				const std::vector<std::pair<size_t,size_t>> &in_edges,
 				unsigned int graphlet_size
 			);
+
+			/**
+			 * Takes ownership of the edge list. The list is released once the
+			 * adjacency structure has been built.
+			 * If sorted is set every edge must be given as (a,b) with a < b,
+			 * ordered lexicographically, and the per-node sort pass is skipped.
+			 * If validate is set, out of range nodes, self-loops, duplicate
+			 * edges and unsorted input (when declared sorted) are rejected.
+			 */
+			Orca(
+				size_t n,
+				std::vector<std::pair<size_t,size_t>> &&in_edges,
+				unsigned int graphlet_size,
+				bool sorted = false,
+				bool validate = true
+			);
+
+			/**
+			 * Counts directly on a caller-owned CSR graph without copying it.
+			 * See CSR for the layout requirements. If validate is set the
+			 * requirements are checked before counting.
+			 */
+			Orca(
+				const CSR &graph,
+				unsigned int graphlet_size,
+				bool validate = true
+			);
+
+			Orca(const Orca&) = delete;
+			Orca &operator=(const Orca&) = delete;
+			Orca(Orca&&) = default;
+
 			void compute();
+
+			/**
+			 * Counts orbits without storing the signature. Each node's row
+			 * is passed to sink as soon as it is complete and then reused,
+			 * so memory for orbit counts stays at one row per worker.
+			 * getOrbits() is empty afterwards until compute() is called.
+			 */
+			void compute(const OrbitSink &sink);
+
+			/**
+			 * Upper bound on the worker ids passed to an OrbitSink.
+			 */
+			unsigned int workers() const;
+
 			const Signature &getOrbits() const;
 			int graphletSize() const;
 
+			MemoryUsage memoryUsage() const;
+
+			/**
+			 * Limits the total memory of the Orca structures to the given
+			 * number of bytes (0 = unlimited). If the common neighbour tables
+			 * used for size 5 would exceed the budget, their counts are
+			 * instead computed on demand by intersecting adjacency lists.
+			 */
+			void setMemoryBudget(size_t bytes);
+			size_t memoryBudget() const;
+
+			/**
+			 * Limits the memory used to cache per-node two-hop counts
+			 * during size 5 counting. Every worker thread gets an equal
+			 * share. Default: 256 MiB.
+			 */
+			void setCacheBudget(size_t bytes);
+
+			/**
+			 * Number of threads used by the parallel passes (0 = all cores).
+			 * The per-node orbit equations of sizes 3-5 and the edge
+			 * triangle pass are parallel; counting the complete graphlets
+			 * for sizes 4 and 5 and building the size 5 common neighbour
+			 * tables run on one thread.
+			 */
+			void setThreads(unsigned int threads);
+
+			/**
+			 * Content key of the graph: a hash of the node count, the
+			 * graphlet size and the normalized edge list, i.e. every edge as
+			 * (a,b) with a < b in sorted order. Graphs with the same nodes
+			 * and edges have the same key however their input was ordered.
+			 */
+			GraphKey key() const;
+
+			/**
+			 * Consults an orbit count cache (null = none) in compute().
+			 * On a hit the counts are read from the cache instead of being
+			 * counted; on a miss they are counted and stored. When streaming
+			 * to a sink a miss is not stored, since the full signature is
+			 * never held in memory.
+			 * The cache must outlive the calls to compute().
+			 */
+			void setOrbitCache(const OrbitCache *cache);
+
 		private:
+			template<typename E>
+			void build(size_t n, const E &in_edges, bool sorted, bool validate);
+			void init();
+			void validateCSR() const;
+			void countEdgeTriangles(std::vector<int> &tri) const;
+			void precomputeCommon();
+			void dispatch();
+			bool load(const GraphKey &graph_key, const OrbitSink *out);
+
+			/**
+			 * Row that receives the counts of node x: the signature row, or
+			 * the worker's scratch row when streaming to a sink.
+			 */
+			int64_t *row(int x, unsigned int worker) {
+				if(!sink) return &orbit(x, 0);
+				std::vector<int64_t> &r = scratch[worker];
+				std::fill(r.begin(), r.end(), 0);
+				return r.data();
+			}
+
+			void emit(int x, unsigned int worker, const int64_t *o) const {
+				if(sink) (*sink)(worker, x, o);
+			}
+
 			void count2();
 			void count3();
 			void count4();
@@ -36,11 +197,20 @@ namespace orca {
 
 			int n, m;
 			unsigned int graphlet_size;
+			size_t memory_budget;
+			unsigned int threads;
+			size_t cache_budget;
+			bool has_common2, has_common3;
 			std::vector<int> deg;
-			std::vector<Pair> edges;
-			std::vector<std::vector<int>> adj;
-			std::vector<std::vector<std::pair<int,int>>> inc;
+			std::vector<size_t> adj_offsets;
+			std::vector<int> adj_neighbours;
+			std::vector<int> edge_ids;
+			CSR adj;
+			Incidence inc;
 			Signature orbit;
+			const OrbitSink *sink;
+			const OrbitCache *orbit_cache;
+			std::vector<std::vector<int64_t>> scratch;
 
 			std::unordered_map<Pair, int, HashPair> common2;
 			std::unordered_map<Triple, int, HashTriple> common3;
@@ -0,0 +1,85 @@
+#ifndef ORCA_PARALLEL_HPP
+#define ORCA_PARALLEL_HPP
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+
+namespace orca {
+	/**
+	 * Number of threads used when none is given.
+	 */
+	inline unsigned int default_threads() {
+		unsigned int t = std::thread::hardware_concurrency();
+		return (t > 0 ? t : 1);
+	}
+
+	/**
+	 * Number of threads parallel_for uses for count indices.
+	 */
+	inline unsigned int parallel_workers(size_t count, unsigned int threads = 0, size_t chunk = 64) {
+		if(threads == 0) threads = default_threads();
+		if(chunk == 0) chunk = 1;
+		return (unsigned int)std::max<size_t>(1, std::min<size_t>(threads, (count + chunk - 1) / chunk));
+	}
+
+	/**
+	 * Like parallel_for, but calls f(worker, i) where worker < threads
+	 * identifies the calling thread, so f can use per-thread state without
+	 * locking. threads is first resolved and capped as in parallel_for;
+	 * use parallel_workers() to size per-thread state.
+	 */
+	template<typename F>
+	void parallel_for_workers(size_t begin, size_t end, F f, unsigned int threads = 0, size_t chunk = 64) {
+		if(begin >= end) return;
+		if(chunk == 0) chunk = 1;
+		threads = parallel_workers(end - begin, threads, chunk);
+
+		if(threads <= 1) {
+			for(size_t i = begin; i < end; ++i) f(0u, i);
+			return;
+		}
+
+		std::atomic<size_t> next(begin);
+		std::exception_ptr error;
+		std::mutex error_mutex;
+
+		auto worker = [&](unsigned int w) {
+			try {
+				for(size_t first; (first = next.fetch_add(chunk)) < end; ) {
+					size_t last = std::min(first + chunk, end);
+					for(size_t i = first; i < last; ++i) f(w, i);
+				}
+			} catch(...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if(!error) error = std::current_exception();
+				next = end;
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for(unsigned int t = 1; t < threads; ++t) {
+			pool.emplace_back(worker, t);
+		}
+		worker(0);
+		for(auto &t : pool) t.join();
+
+		if(error) std::rethrow_exception(error);
+	}
+
+	/**
+	 * Calls f(i) for every i in [begin, end) using the given number of
+	 * threads (0 = default_threads()). Indices are handed out dynamically
+	 * in chunks, so uneven per-index work (e.g. hub nodes) is balanced.
+	 * The first exception thrown by f is rethrown in the calling thread.
+	 */
+	template<typename F>
+	void parallel_for(size_t begin, size_t end, F f, unsigned int threads = 0, size_t chunk = 64) {
+		parallel_for_workers(begin, end, [&f](unsigned int, size_t i) { f(i); }, threads, chunk);
+	}
+}
+
+#endif
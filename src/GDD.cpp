@@ -1,9 +1,11 @@
-#include <fstream>
+#include <memory>
 #include <tclap/CmdLine.h>
-#include <graph/GraphReader.hpp>
 #include <orca/Orca.hpp>
+#include <orca/OrbitCache.hpp>
+#include <orca/GDVFile.hpp>
 #include <libgraphlet/GDD.hpp>
 #include "Graph.hpp"
+#include "Output.hpp"
 
 int main(int argc, const char **argv) {
 	TCLAP::CmdLine cmd(
@@ -14,46 +16,53 @@ int main(int argc, const char **argv) {
 	);
 
 	TCLAP::ValueArg<int> graphletSizeArg("s", "size", "Graphlet size. 2-5 supported. Default: 4", false, 4, "size", cmd);
-	TCLAP::UnlabeledValueArg<std::string> graphArg("graph", "Path to graph file", true, "", "GRAPH", cmd);
+	TCLAP::UnlabeledValueArg<std::string> graphArg("graph", "Path to graph file or binary GDV file", true, "", "GRAPH", cmd);
 	TCLAP::UnlabeledValueArg<std::string> outputArg("output", "Output file", true, "", "FILE", cmd);
 	TCLAP::SwitchArg normalizeSwitch("n", "normalize", "Normalize distribution", cmd, false);
+	CacheArgs cacheArgs(cmd, false);
 
 	cmd.parse(argc, argv);
 
-	// Read graph
-	std::cerr << "Loading graph" << std::endl;
-	Graph g;
-	graph::readGraph(graphArg.getValue(), g);
-	remove_edge_loops(g);
-	std::vector<std::pair<size_t,size_t>> edges;
-	get_edges(g, edges);
-
-	// Compute GDVs
-	std::cerr << "Computing graphlet degree vectors" << std::endl;
-	orca::Orca orca(num_vertices(g), edges, graphletSizeArg.getValue());
-	orca.compute();
-
-	// Compute GDD
-	std::cerr << "Computing graphlet degree distribution" << std::endl;
+	std::unique_ptr<orca::OrbitCache> cache = cacheArgs.open();
+
+	libgraphlet::GDDHistogram hist;
+	if(orca::is_gdv_file(graphArg.getValue())) {
+		// Use stored GDVs
+		std::cerr << "Computing graphlet degree distribution from stored GDVs" << std::endl;
+		orca::GDVFile gdv(graphArg.getValue());
+		libgraphlet::gdd_histogram(gdv, hist);
+	} else {
+		// Read graph
+		std::cerr << "Loading graph" << std::endl;
+		orca::EdgeList g;
+		load_graph(graphArg.getValue(), g);
+
+		// Compute GDD, counting orbits straight into histograms
+		std::cerr << "Computing graphlet degree distribution" << std::endl;
+		orca::Orca orca(g.nodes(), std::move(g.edges), graphletSizeArg.getValue(), true);
+		orca.setOrbitCache(cache.get());
+		libgraphlet::count_gdd_histogram(orca, hist);
+	}
 	libgraphlet::GDD gdd;
-	libgraphlet::gdd(orca, gdd, normalizeSwitch.getValue());
+	libgraphlet::gdd(hist, gdd, normalizeSwitch.getValue());
 
 	// Write GDD to file
-	std::ofstream file(outputArg.getValue());
-	for(auto &v : gdd) {
+	write_rows(outputArg.getValue(), gdd.size(), [&](size_t j, std::string &out) {
+		const auto &v = gdd[j];
 		size_t max_key = (v.size() > 0 ? v.rbegin()->first : 0);
 
+		auto it = v.begin();
 		for(size_t i = 0; i <= max_key; ++i) {
-			if(v.find(i) != v.end()) {
-				file << v[i];
+			if(it != v.end() && it->first == i) {
+				append_general(out, it->second);
+				++it;
 			} else {
-				file << "0";
+				out.push_back('0');
 			}
-			if(i < max_key) file << " ";
+			if(i < max_key) out.push_back(' ');
 		}
-		file << "\n";
-	}
-	file.close();
+		out.push_back('\n');
+	}, 0, 1);
 
 	return 0;
 }
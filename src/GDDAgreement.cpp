@@ -1,11 +1,33 @@
 #include <fstream>
 #include <numeric>
+#include <future>
+#include <memory>
 #include <tclap/CmdLine.h>
-#include <graph/GraphReader.hpp>
 #include <orca/Orca.hpp>
+#include <orca/OrbitCache.hpp>
+#include <orca/GDVFile.hpp>
 #include <libgraphlet/GDD.hpp>
 #include "Graph.hpp"
 
+namespace {
+	// Reads stored GDVs, or loads the graph and counts its orbits straight
+	// into histograms. Counting structures are released on return.
+	void load_gdd(const std::string &path, int graphlet_size, const orca::OrbitCache *cache, libgraphlet::GDD &gdd) {
+		libgraphlet::GDDHistogram hist;
+		if(orca::is_gdv_file(path)) {
+			orca::GDVFile gdv(path);
+			libgraphlet::gdd_histogram(gdv, hist);
+		} else {
+			orca::EdgeList g;
+			load_graph(path, g);
+			orca::Orca orca(g.nodes(), std::move(g.edges), graphlet_size, true);
+			orca.setOrbitCache(cache);
+			libgraphlet::count_gdd_histogram(orca, hist);
+		}
+		libgraphlet::gdd(hist, gdd, true);
+	}
+}
+
 int main(int argc, const char **argv) {
 	TCLAP::CmdLine cmd(
 		"gdd_agreement",
@@ -15,44 +37,27 @@ int main(int argc, const char **argv) {
 	);
 
 	TCLAP::ValueArg<int> graphletSizeArg("s", "size", "Graphlet size. 2-5 supported. Default: 4", false, 4, "size", cmd);
-	TCLAP::UnlabeledValueArg<std::string> graph1Arg("graph1", "Path to first graph file", true, "", "GRAPH", cmd);
-	TCLAP::UnlabeledValueArg<std::string> graph2Arg("graph2", "Path to second graph file", true, "", "GRAPH", cmd);
+	TCLAP::UnlabeledValueArg<std::string> graph1Arg("graph1", "Path to first graph file or binary GDV file", true, "", "GRAPH", cmd);
+	TCLAP::UnlabeledValueArg<std::string> graph2Arg("graph2", "Path to second graph file or binary GDV file", true, "", "GRAPH", cmd);
 	TCLAP::UnlabeledValueArg<std::string> outputArg("output", "Output file", true, "", "FILE", cmd);
+	CacheArgs cacheArgs(cmd, false);
 
 	cmd.parse(argc, argv);
 
-	// Load graphs
-	std::cerr << "Loading graphs (1/2)";
-	Graph g1;
-	graph::readGraph(graph1Arg.getValue(), g1);
-	remove_edge_loops(g1);
-	std::vector<std::pair<size_t,size_t>> edges1;
-	get_edges(g1, edges1);
-
-	std::cerr << "\rLoading graphs (2/2)" << std::endl;
-	Graph g2;
-	graph::readGraph(graph2Arg.getValue(), g2);
-	remove_edge_loops(g2);
-	std::vector<std::pair<size_t,size_t>> edges2;
-	get_edges(g2, edges2);
-
-	// Compute GDVs
-	std::cerr << "Computing graphlet degree vectors (1/2)";
-	orca::Orca orca1(num_vertices(g1), edges1, graphletSizeArg.getValue());
-	orca1.compute();
-
-	std::cerr << "\rComputing graphlet degree vectors (2/2)" << std::endl;
-	orca::Orca orca2(num_vertices(g2), edges2, graphletSizeArg.getValue());
-	orca2.compute();
+	if(!check_graphlet_sizes(graph1Arg.getValue(), graph2Arg.getValue(), graphletSizeArg)) {
+		return 1;
+	}
 
-	// Compute GDDs
-	std::cerr << "Computing graphlet degree distributions (1/2)";
-	libgraphlet::GDD gdd1;
-	libgraphlet::gdd(orca1, gdd1, true);
+	std::unique_ptr<orca::OrbitCache> cache = cacheArgs.open();
 
-	std::cerr << "\rComputing graphlet degree distributions (2/2)" << std::endl;
-	libgraphlet::GDD gdd2;
-	libgraphlet::gdd(orca2, gdd2, true);
+	// Compute GDDs. Each network is loaded, counted and summarized on its
+	// own thread, so the slower network determines the time.
+	std::cerr << "Computing graphlet degree distributions" << std::endl;
+	libgraphlet::GDD gdd1, gdd2;
+	std::future<void> second = std::async(std::launch::async, load_gdd,
+		graph2Arg.getValue(), graphletSizeArg.getValue(), cache.get(), std::ref(gdd2));
+	load_gdd(graph1Arg.getValue(), graphletSizeArg.getValue(), cache.get(), gdd1);
+	second.get();
 
 	// Compute GGD-agreement
 	std::cerr << "Computing GDD agreement" << std::endl;
@@ -1,8 +1,12 @@
 #include <fstream>
+#include <memory>
 #include <tclap/CmdLine.h>
-#include <graph/GraphReader.hpp>
 #include <orca/Orca.hpp>
+#include <orca/OrbitCache.hpp>
+#include <orca/Estimate.hpp>
+#include <orca/GDVFile.hpp>
 #include "Graph.hpp"
+#include "Output.hpp"
 
 int main(int argc, const char **argv) {
 	TCLAP::CmdLine cmd(
@@ -15,30 +19,67 @@ int main(int argc, const char **argv) {
 	TCLAP::ValueArg<int> graphletSizeArg("s", "size", "Graphlet size. 2-5 supported. Default: 4", false, 4, "size", cmd);
 	TCLAP::UnlabeledValueArg<std::string> graphArg("graph", "Path to graph file", true, "", "GRAPH", cmd);
 	TCLAP::UnlabeledValueArg<std::string> outputArg("output", "Output file", true, "", "FILE", cmd);
+	TCLAP::ValueArg<size_t> memoryArg("m", "memory", "Memory budget in MiB. 0 = unlimited. Default: 0", false, 0, "MiB", cmd);
+	TCLAP::ValueArg<unsigned int> threadsArg("t", "threads", "Number of threads. 0 = all cores. Default: 0", false, 0, "threads", cmd);
+	TCLAP::SwitchArg estimateSwitch("e", "estimate", "Estimate runtime and memory use instead of counting", cmd, false);
+	TCLAP::SwitchArg binarySwitch("b", "binary", "Write a binary GDV file with node labels, readable by gdd and gdv_similarity", cmd, false);
+	CacheArgs cacheArgs(cmd);
 
 	cmd.parse(argc, argv);
 
+	std::unique_ptr<orca::OrbitCache> cache = cacheArgs.open();
+
 	// Read graph
-	Graph g;
-	graph::readGraph(graphArg.getValue(), g);
-	remove_edge_loops(g);
-	std::vector<std::pair<size_t,size_t>> edges;
-	get_edges(g, edges);
+	orca::EdgeList g;
+	load_graph(graphArg.getValue(), g, threadsArg.getValue());
+
+	if(estimateSwitch.getValue()) {
+		orca::CostEstimate est = orca::estimate(g.nodes(), g.edges, graphletSizeArg.getValue(),
+			100000, 2.0, threadsArg.getValue(), memoryArg.getValue() << 20);
+
+		std::ofstream file(outputArg.getValue());
+		file << "nodes\t" << est.nodes << "\n";
+		file << "edges\t" << est.edges << "\n";
+		file << "wedges\t" << est.wedges << "\n";
+		file << "triangles\t" << est.triangles << "\n";
+		file << "work\t" << est.work << "\n";
+		file << "common2_entries\t" << est.common2_entries << "\n";
+		file << "common3_entries\t" << est.common3_entries << "\n";
+		file << "two_hop_entries\t" << est.two_hop_entries << "\n";
+		file << "memory_graph\t" << est.memory_graph << "\n";
+		file << "memory_orbits\t" << est.memory_orbits << "\n";
+		file << "memory_common\t" << est.memory_common << "\n";
+		file << "memory_temp\t" << est.memory_temp << "\n";
+		file << "memory_peak\t" << est.memory_peak << "\n";
+		file << "seconds\t" << est.seconds << "\n";
+		file.close();
+
+		return 0;
+	}
 
 	// Compute GDVs
-	orca::Orca orca(num_vertices(g), edges, graphletSizeArg.getValue());
+	orca::Orca orca(g.nodes(), std::move(g.edges), graphletSizeArg.getValue(), true);
+	orca.setMemoryBudget(memoryArg.getValue() << 20);
+	orca.setThreads(threadsArg.getValue());
+	orca.setOrbitCache(cache.get());
 	orca.compute();
 
+	if(binarySwitch.getValue()) {
+		orca::write_gdv_file(outputArg.getValue(), orca, g.labels);
+		return 0;
+	}
+
 	// Write to file
 	const auto &orbits = orca.getOrbits();
-	std::ofstream file(outputArg.getValue());
-	for(auto it1 = orbits.begin1(); it1 != orbits.end1(); ++it1) {
-		for(auto it = it1.begin(); it != it1.end(); ++it) {
-			file << *it << " ";
+	const size_t cols = orbits.size2();
+	const int64_t *data = orbits.size1() > 0 ? &(orbits.data()[0]) : nullptr;
+	write_rows(outputArg.getValue(), orbits.size1(), [&](size_t i, std::string &out) {
+		for(size_t j = 0; j < cols; ++j) {
+			append_int(out, data[i*cols + j]);
+			out.push_back(' ');
 		}
-		file << "\n";
-	}
-	file.close();
+		out.push_back('\n');
+	}, threadsArg.getValue(), 4096);
 
 	return 0;
 }
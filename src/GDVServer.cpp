@@ -0,0 +1,623 @@
+#include <map>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <tclap/CmdLine.h>
+#include <orca/Orca.hpp>
+#include <orca/OrbitCache.hpp>
+#include <orca/GDVFile.hpp>
+#include <libgraphlet/Similarity.hpp>
+#include <libgraphlet/GDD.hpp>
+#include "Graph.hpp"
+#include "Output.hpp"
+
+namespace {
+	// Longest accepted request line
+	const size_t MAX_LINE = 1 << 20;
+
+	// Requests per command kept for latency percentiles
+	const size_t LATENCY_WINDOW = 1024;
+
+	/**
+	 * Line protocol. A request is a command and its whitespace separated
+	 * arguments on one line. The response is "OK <rows>" followed by that
+	 * many tab separated rows, or a single "ERR <message>" line:
+	 *
+	 *   LOAD name path                  name, nodes, graphlet size
+	 *   UNLOAD name                     no rows
+	 *   LIST                            name, nodes, graphlet size, path
+	 *   GDV network node                node, orbit counts
+	 *   SIM network1 node1 network2 node2
+	 *                                   node1, node2, similarity
+	 *   TOPK network1 node network2 k   node, match, similarity
+	 *   AGREEMENT network1 network2     "mean" and every orbit, agreement
+	 *   STATS                           command, requests, errors, and
+	 *                                   mean, p50, p99 and max latency in us
+	 *   QUIT                            closes the connection
+	 *
+	 * A client connecting while the maximum number of connections is
+	 * open gets "ERR Too many connections." and is disconnected.
+	 */
+	const char *COMMANDS[] = { "LOAD", "UNLOAD", "LIST", "GDV", "SIM", "TOPK", "AGREEMENT", "STATS" };
+
+	// Write end of the pipe that wakes the accept loop on a signal. The
+	// signal may be delivered to any thread, so a flag alone would leave
+	// the loop blocked until the next client connects.
+	int wake_fd = -1;
+
+	void on_signal(int) {
+		int saved = errno;
+		if(write(wake_fd, "x", 1) < 0) { }
+		errno = saved;
+	}
+
+	/**
+	 * A loaded network: node labels, raw orbit counts, and the prepared
+	 * signature and GDD used by queries. Immutable once loaded, so
+	 * queries share it without locking.
+	 */
+	struct Network {
+		std::string path;
+		std::vector<std::string> labels;
+		std::unordered_map<std::string, size_t> index;
+
+		// Counts live in either the Orca instance or the mapped file
+		std::unique_ptr<orca::Orca> orca;
+		std::unique_ptr<orca::GDVFile> file;
+		const int64_t *counts;
+		size_t orbits, stride;
+		int graphlet_size;
+
+		std::unique_ptr<libgraphlet::PreparedSignature> sig;
+		libgraphlet::SparseGDD gdd;
+
+		size_t node(const std::string &label) const {
+			auto it = index.find(label);
+			if(it == index.end()) {
+				throw std::invalid_argument("Unknown node " + label + ".");
+			}
+			return it->second;
+		}
+	};
+
+	// Reads stored GDVs, or loads the graph and counts its orbits.
+	// Nodes of GDV files without labels are named by index.
+	std::shared_ptr<const Network> load_network(
+		const std::string &path,
+		int graphlet_size,
+		unsigned int threads,
+		const orca::OrbitCache *cache
+	) {
+		std::shared_ptr<Network> net = std::make_shared<Network>();
+		net->path = path;
+		if(orca::is_gdv_file(path)) {
+			net->file.reset(new orca::GDVFile(path));
+			const orca::GDVFile &gdv = *net->file;
+			net->labels = gdv.labels();
+			if(net->labels.empty()) {
+				for(size_t i = 0; i < gdv.size(); ++i) net->labels.push_back(std::to_string(i));
+			}
+			net->counts = gdv.data();
+			net->orbits = gdv.orbits();
+			net->stride = gdv.stride();
+			net->graphlet_size = gdv.graphletSize();
+		} else {
+			orca::EdgeList g;
+			load_graph(path, g, threads);
+			net->labels = std::move(g.labels);
+			net->orca.reset(new orca::Orca(net->labels.size(), std::move(g.edges), graphlet_size, true));
+			net->orca->setThreads(threads);
+			net->orca->setOrbitCache(cache);
+			net->orca->compute();
+			const orca::Signature &sig = net->orca->getOrbits();
+			net->counts = sig.size1() > 0 ? &(sig.data()[0]) : nullptr;
+			net->orbits = sig.size2();
+			net->stride = sig.size2();
+			net->graphlet_size = graphlet_size;
+		}
+
+		for(size_t i = 0; i < net->labels.size(); ++i) net->index[net->labels[i]] = i;
+
+		const size_t n = net->labels.size();
+		net->sig.reset(new libgraphlet::PreparedSignature(net->counts, n, net->orbits, net->stride));
+		libgraphlet::GDDHistogram hist;
+		libgraphlet::gdd_histogram(net->counts, n, net->orbits, net->stride, hist, threads);
+		libgraphlet::gdd(hist, net->gdd, true);
+		return net;
+	}
+
+	/**
+	 * Request count, error count and latencies of one command. Percentiles
+	 * are taken over the last LATENCY_WINDOW requests.
+	 */
+	struct Latency {
+		uint64_t count, errors, total_us, max_us;
+		std::vector<uint64_t> recent;
+
+		Latency() : count(0), errors(0), total_us(0), max_us(0) { }
+
+		void add(uint64_t us, bool error) {
+			if(recent.size() < LATENCY_WINDOW) recent.push_back(us);
+			else recent[count % LATENCY_WINDOW] = us;
+			++count;
+			if(error) ++errors;
+			total_us += us;
+			max_us = std::max(max_us, us);
+		}
+	};
+
+	/**
+	 * Networks and latency metrics shared by all connections.
+	 */
+	class Server {
+		public:
+			Server(int graphlet_size, unsigned int threads, const orca::OrbitCache *cache, bool verbose)
+			: graphlet_size(graphlet_size)
+			, threads(threads)
+			, cache(cache)
+			, verbose(verbose)
+			{ }
+
+			std::shared_ptr<const Network> load(const std::string &name, const std::string &path) {
+				// Counting happens unlocked; queries in flight keep the old network
+				std::shared_ptr<const Network> net = load_network(path, graphlet_size, threads, cache);
+				std::lock_guard<std::mutex> lock(networks_mutex);
+				networks[name] = net;
+				return net;
+			}
+
+			/**
+			 * Handles one request line, appending the response to out.
+			 * Returns false if the connection should be closed.
+			 */
+			bool handle(const std::string &line, std::string &out);
+
+		private:
+			std::shared_ptr<const Network> get(const std::string &name) const {
+				std::lock_guard<std::mutex> lock(networks_mutex);
+				auto it = networks.find(name);
+				if(it == networks.end()) {
+					throw std::invalid_argument("Unknown network " + name + ".");
+				}
+				return it->second;
+			}
+
+			// Appends the rows of a response, returns the number of rows
+			size_t run(const std::string &command, const std::vector<std::string> &args, std::string &out);
+
+			void record(const std::string &command, uint64_t us, bool error) {
+				std::lock_guard<std::mutex> lock(stats_mutex);
+				stats[command].add(us, error);
+			}
+
+			int graphlet_size;
+			unsigned int threads;
+			const orca::OrbitCache *cache;
+			bool verbose;
+
+			mutable std::mutex networks_mutex;
+			std::map<std::string, std::shared_ptr<const Network>> networks;
+
+			std::mutex stats_mutex;
+			std::map<std::string, Latency> stats;
+	};
+
+	void expect_args(const std::vector<std::string> &args, size_t count, const char *usage) {
+		if(args.size() != count) {
+			throw std::invalid_argument(std::string("Usage: ") + usage);
+		}
+	}
+
+	size_t parse_count(const std::string &s) {
+		char *end = nullptr;
+		unsigned long long v = strtoull(s.c_str(), &end, 10);
+		if(s.empty() || *end != '\0' || s[0] == '-') {
+			throw std::invalid_argument("Not a count: " + s + ".");
+		}
+		return (size_t)v;
+	}
+
+	size_t Server::run(const std::string &command, const std::vector<std::string> &args, std::string &out) {
+		if(command == "LOAD") {
+			expect_args(args, 2, "LOAD name path");
+			std::shared_ptr<const Network> net = load(args[0], args[1]);
+			out.append(args[0]);
+			out.push_back('\t');
+			append_int(out, net->labels.size());
+			out.push_back('\t');
+			append_int(out, net->graphlet_size);
+			out.push_back('\n');
+			return 1;
+		}
+
+		if(command == "UNLOAD") {
+			expect_args(args, 1, "UNLOAD name");
+			std::lock_guard<std::mutex> lock(networks_mutex);
+			if(networks.erase(args[0]) == 0) {
+				throw std::invalid_argument("Unknown network " + args[0] + ".");
+			}
+			return 0;
+		}
+
+		if(command == "LIST") {
+			expect_args(args, 0, "LIST");
+			std::lock_guard<std::mutex> lock(networks_mutex);
+			for(auto &it : networks) {
+				out.append(it.first);
+				out.push_back('\t');
+				append_int(out, it.second->labels.size());
+				out.push_back('\t');
+				append_int(out, it.second->graphlet_size);
+				out.push_back('\t');
+				out.append(it.second->path);
+				out.push_back('\n');
+			}
+			return networks.size();
+		}
+
+		if(command == "GDV") {
+			expect_args(args, 2, "GDV network node");
+			std::shared_ptr<const Network> net = get(args[0]);
+			const size_t i = net->node(args[1]);
+			const int64_t *row = net->counts + i * net->stride;
+			out.append(net->labels[i]);
+			for(size_t k = 0; k < net->orbits; ++k) {
+				out.push_back('\t');
+				append_int(out, row[k]);
+			}
+			out.push_back('\n');
+			return 1;
+		}
+
+		if(command == "SIM") {
+			expect_args(args, 4, "SIM network1 node1 network2 node2");
+			std::shared_ptr<const Network> a = get(args[0]), b = get(args[2]);
+			if(a->orbits != b->orbits) {
+				throw std::invalid_argument("Networks do not have the same number of orbits.");
+			}
+			const size_t i = a->node(args[1]), j = b->node(args[3]);
+			out.append(a->labels[i]);
+			out.push_back('\t');
+			out.append(b->labels[j]);
+			out.push_back('\t');
+			append_fixed(out, libgraphlet::similarity(*a->sig, i, *b->sig, j));
+			out.push_back('\n');
+			return 1;
+		}
+
+		if(command == "TOPK") {
+			expect_args(args, 4, "TOPK network1 node network2 k");
+			std::shared_ptr<const Network> a = get(args[0]), b = get(args[2]);
+			if(a->orbits != b->orbits) {
+				throw std::invalid_argument("Networks do not have the same number of orbits.");
+			}
+			const size_t i = a->node(args[1]);
+			const size_t nb = b->labels.size();
+			const size_t k = std::min(parse_count(args[3]), nb);
+
+			// One row of the similarity matrix, best k by decreasing score
+			std::vector<float> row(nb);
+			libgraphlet::similarity_rows(*a->sig, *b->sig, i, i + 1, row.data(), threads);
+			std::vector<size_t> order(nb);
+			std::iota(order.begin(), order.end(), 0);
+			std::partial_sort(order.begin(), order.begin() + k, order.end(), [&row](size_t x, size_t y) {
+				return row[x] > row[y] || (row[x] == row[y] && x < y);
+			});
+
+			for(size_t r = 0; r < k; ++r) {
+				out.append(a->labels[i]);
+				out.push_back('\t');
+				out.append(b->labels[order[r]]);
+				out.push_back('\t');
+				append_fixed(out, row[order[r]]);
+				out.push_back('\n');
+			}
+			return k;
+		}
+
+		if(command == "AGREEMENT") {
+			expect_args(args, 2, "AGREEMENT network1 network2");
+			std::shared_ptr<const Network> a = get(args[0]), b = get(args[1]);
+			if(a->graphlet_size != b->graphlet_size) {
+				throw std::invalid_argument("Graphlet sizes do not match: " + args[0] + " has size "
+					+ std::to_string(a->graphlet_size) + ", " + args[1] + " has size "
+					+ std::to_string(b->graphlet_size) + ".");
+			}
+			std::vector<float> gdda;
+			libgraphlet::gdd_agreement(a->gdd, b->gdd, gdda);
+			float mean = std::accumulate(gdda.begin(), gdda.end(), 0.0f) / (float)gdda.size();
+
+			out.append("mean\t");
+			append_general(out, mean);
+			out.push_back('\n');
+			for(size_t k = 0; k < gdda.size(); ++k) {
+				append_int(out, k);
+				out.push_back('\t');
+				append_general(out, gdda[k]);
+				out.push_back('\n');
+			}
+			return gdda.size() + 1;
+		}
+
+		if(command == "STATS") {
+			expect_args(args, 0, "STATS");
+			std::lock_guard<std::mutex> lock(stats_mutex);
+			for(auto &it : stats) {
+				const Latency &l = it.second;
+				std::vector<uint64_t> sorted(l.recent);
+				std::sort(sorted.begin(), sorted.end());
+				out.append(it.first);
+				for(uint64_t v : { l.count, l.errors, l.total_us / l.count,
+					sorted[sorted.size() / 2], sorted[sorted.size() * 99 / 100], l.max_us }) {
+					out.push_back('\t');
+					append_int(out, v);
+				}
+				out.push_back('\n');
+			}
+			return stats.size();
+		}
+
+		throw std::invalid_argument("Unknown command " + command + ".");
+	}
+
+	bool Server::handle(const std::string &line, std::string &out) {
+		auto start = std::chrono::steady_clock::now();
+
+		std::istringstream ss(line);
+		std::string command, arg;
+		std::vector<std::string> args;
+		ss >> command;
+		while(ss >> arg) args.push_back(arg);
+		if(command.empty()) return true;
+		if(command == "QUIT") return false;
+
+		// Rows are formatted first, as the status line holds their count
+		std::string rows;
+		bool error = false;
+		try {
+			size_t count = run(command, args, rows);
+			out.append("OK ");
+			append_int(out, count);
+			out.push_back('\n');
+			out.append(rows);
+		} catch(const std::exception &e) {
+			error = true;
+			out.append("ERR ");
+			out.append(e.what());
+			out.push_back('\n');
+		}
+
+		uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count();
+		const bool known = std::find(std::begin(COMMANDS), std::end(COMMANDS), command) != std::end(COMMANDS);
+		record(known ? command : "UNKNOWN", us, error);
+		if(verbose) {
+			std::cerr << line << " (" << us << " us" << (error ? ", failed" : "") << ")" << std::endl;
+		}
+		return true;
+	}
+
+	bool send_all(int fd, const std::string &data) {
+		size_t sent = 0;
+		while(sent < data.size()) {
+			ssize_t r = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+			if(r < 0 && errno == EINTR) continue;
+			if(r <= 0) return false;
+			sent += r;
+		}
+		return true;
+	}
+
+	// Answers requests of one client until it disconnects or quits
+	void serve(Server &server, int fd) {
+		std::string buffer, out;
+		char chunk[65536];
+		bool open = true;
+		while(open) {
+			ssize_t r = recv(fd, chunk, sizeof(chunk), 0);
+			if(r < 0 && errno == EINTR) continue;
+			if(r <= 0) break;
+			buffer.append(chunk, r);
+
+			size_t begin = 0, eol;
+			out.clear();
+			while(open && (eol = buffer.find('\n', begin)) != std::string::npos) {
+				std::string line = buffer.substr(begin, eol - begin);
+				if(!line.empty() && line.back() == '\r') line.pop_back();
+				open = server.handle(line, out);
+				begin = eol + 1;
+			}
+			buffer.erase(0, begin);
+			if(buffer.size() > MAX_LINE) {
+				out.append("ERR Request line too long.\n");
+				open = false;
+			}
+			if(!out.empty() && !send_all(fd, out)) break;
+		}
+	}
+
+	/**
+	 * Threads serving the open connections, at most max_open of them
+	 * (0 = unlimited). Threads of closed connections are joined by reap();
+	 * close() disconnects all clients and waits for requests in progress
+	 * to finish.
+	 */
+	class Connections {
+		public:
+			explicit Connections(size_t max_open) : max_open(max_open) { }
+			~Connections() { close(); }
+
+			/**
+			 * Serves fd on a new thread, which closes it when done. Returns
+			 * false and leaves fd to the caller if max_open are open.
+			 */
+			bool start(Server &server, int fd) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if(max_open > 0 && threads.size() >= max_open) return false;
+				threads[fd] = std::thread([this, &server, fd]() {
+					serve(server, fd);
+					finish(fd);
+				});
+				return true;
+			}
+
+			void reap() {
+				std::vector<std::thread> done;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					done.swap(finished);
+				}
+				for(std::thread &t : done) t.join();
+			}
+
+			void close() {
+				std::vector<std::thread> all;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					for(auto &it : threads) {
+						// Wakes the thread from recv; its fd stays open until it exits
+						shutdown(it.first, SHUT_RDWR);
+						all.push_back(std::move(it.second));
+					}
+					threads.clear();
+				}
+				for(std::thread &t : all) t.join();
+				reap();
+			}
+
+		private:
+			// The fd is closed under the lock, so close() never shuts down
+			// a reused descriptor
+			void finish(int fd) {
+				std::lock_guard<std::mutex> lock(mutex);
+				::close(fd);
+				auto it = threads.find(fd);
+				if(it != threads.end()) {
+					finished.push_back(std::move(it->second));
+					threads.erase(it);
+				}
+			}
+
+			const size_t max_open;
+			std::mutex mutex;
+			std::map<int, std::thread> threads;
+			std::vector<std::thread> finished;
+	};
+}
+
+int main(int argc, const char **argv) {
+	TCLAP::CmdLine cmd(
+		"gdv_server",
+		"Serve GDV, similarity and GDD-agreement queries of networks kept in memory over a Unix domain socket.",
+		"0.1",
+		"Simon Larsen <simonhffh@gmail.com>"
+	);
+
+	TCLAP::ValueArg<int> graphletSizeArg("s", "size", "Graphlet size. 2-5 supported. Default: 4", false, 4, "size", cmd);
+	TCLAP::UnlabeledValueArg<std::string> socketArg("socket", "Path of the Unix domain socket to listen on", true, "", "SOCKET", cmd);
+	TCLAP::MultiArg<std::string> loadArg("l", "load", "Load a graph file or binary GDV file under a name before serving. Repeatable", false, "NAME=PATH", cmd);
+	TCLAP::ValueArg<unsigned int> threadsArg("t", "threads", "Number of threads per request. 0 = all cores. Default: 0", false, 0, "threads", cmd);
+	TCLAP::ValueArg<size_t> maxConnectionsArg("n", "max-connections", "Maximum number of open connections; further clients are refused. 0 = unlimited. Default: 64", false, 64, "connections", cmd);
+	TCLAP::SwitchArg verboseSwitch("v", "verbose", "Log every request with its latency", cmd, false);
+	CacheArgs cacheArgs(cmd);
+
+	cmd.parse(argc, argv);
+
+	std::unique_ptr<orca::OrbitCache> cache = cacheArgs.open();
+
+	Server server(graphletSizeArg.getValue(), threadsArg.getValue(), cache.get(), verboseSwitch.getValue());
+	for(const std::string &spec : loadArg.getValue()) {
+		size_t eq = spec.find('=');
+		if(eq == std::string::npos || eq == 0) {
+			std::cerr << "error: expected NAME=PATH, got " << spec << std::endl;
+			return 1;
+		}
+		std::cerr << "Loading " << spec.substr(eq + 1) << std::endl;
+		server.load(spec.substr(0, eq), spec.substr(eq + 1));
+	}
+
+	const std::string &path = socketArg.getValue();
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(path.size() >= sizeof(addr.sun_path)) {
+		std::cerr << "error: socket path too long: " << path << std::endl;
+		return 1;
+	}
+	strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+	// Replace a socket left behind by an earlier run, but nothing else
+	struct stat st;
+	if(lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path.c_str());
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+		std::cerr << "error: could not listen on " << path << ": " << strerror(errno) << std::endl;
+		return 1;
+	}
+
+	// Signals are turned into a byte on a pipe the accept loop polls
+	int wake[2];
+	if(pipe(wake) != 0) {
+		std::cerr << "error: could not create pipe: " << strerror(errno) << std::endl;
+		return 1;
+	}
+	fcntl(wake[1], F_SETFL, O_NONBLOCK);
+	wake_fd = wake[1];
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, nullptr);
+	sigaction(SIGTERM, &sa, nullptr);
+
+	std::cerr << "Listening on " << path << std::endl;
+	Connections connections(maxConnectionsArg.getValue());
+	while(true) {
+		struct pollfd fds[2] = { { listener, POLLIN, 0 }, { wake[0], POLLIN, 0 } };
+		if(poll(fds, 2, -1) < 0) {
+			if(errno == EINTR) continue;
+			std::cerr << "error: poll failed: " << strerror(errno) << std::endl;
+			break;
+		}
+		if(fds[1].revents != 0) break;
+		if(fds[0].revents == 0) continue;
+
+		int fd = accept(listener, nullptr, nullptr);
+		if(fd < 0) {
+			if(errno == EINTR || errno == ECONNABORTED) continue;
+			std::cerr << "error: accept failed: " << strerror(errno) << std::endl;
+			break;
+		}
+		connections.reap();
+		if(!connections.start(server, fd)) {
+			send_all(fd, "ERR Too many connections.\n");
+			close(fd);
+		}
+	}
+
+	// Clients are disconnected and their threads joined before the
+	// server and cache go away
+	std::cerr << "Shutting down" << std::endl;
+	connections.close();
+	close(listener);
+	unlink(path.c_str());
+	std::cerr << "Done!" << std::endl;
+
+	return 0;
+}
@@ -1,10 +1,16 @@
 #include <fstream>
+#include <map>
+#include <memory>
+#include <future>
+#include <algorithm>
 #include <tclap/CmdLine.h>
-#include <boost/format.hpp>
-#include <graph/GraphReader.hpp>
-#include <orca/Orca.hpp>
+#include <orca/OrbitCache.hpp>
 #include <libgraphlet/Similarity.hpp>
+#include <libgraphlet/GDVIndex.hpp>
+#include <libgraphlet/SimilarityFile.hpp>
 #include "Graph.hpp"
+#include "Signature.hpp"
+#include "Output.hpp"
 
 int main(int argc, const char **argv) {
 	TCLAP::CmdLine cmd(
@@ -15,49 +21,176 @@ int main(int argc, const char **argv) {
 	);
 
 	TCLAP::ValueArg<int> graphletSizeArg("s", "size", "Graphlet size. 2-5 supported. Default: 4", false, 4, "size", cmd);
-	TCLAP::UnlabeledValueArg<std::string> graph1Arg("graph1", "Path to first graph file", true, "", "GRAPH", cmd);
-	TCLAP::UnlabeledValueArg<std::string> graph2Arg("graph2", "Path to second graph file", true, "", "GRAPH", cmd);
+	TCLAP::UnlabeledValueArg<std::string> graph1Arg("graph1", "Path to first graph file or binary GDV file", true, "", "GRAPH", cmd);
+	TCLAP::UnlabeledValueArg<std::string> graph2Arg("graph2", "Path to second graph file or binary GDV file", true, "", "GRAPH", cmd);
 	TCLAP::UnlabeledValueArg<std::string> outputArg("output", "Output file", true, "", "FILE", cmd);
+	TCLAP::ValueArg<size_t> topArg("k", "top", "Only output the k most similar nodes of graph 2 for each node of graph 1. 0 = all. Default: 0", false, 0, "k", cmd);
+	TCLAP::ValueArg<size_t> approxArg("a", "approximate", "Use an approximate nearest neighbour index for -k, examining this many candidates per node", false, 0, "candidates", cmd);
+	TCLAP::ValueArg<std::string> pairsArg("p", "pairs", "Only compute similarity of the node pairs listed in file, one tab or space separated pair per line", false, "", "FILE", cmd);
+	TCLAP::ValueArg<float> cutoffArg("c", "cutoff", "Only output pairs with similarity at least the cutoff", false, 0.0f, "cutoff", cmd);
+	TCLAP::ValueArg<size_t> blockArg("b", "block", "Write the matrix as a binary file, computed and written in blocks of this many rows", false, 0, "rows", cmd);
+	TCLAP::SwitchArg quantizeSwitch("q", "quantize", "Compute on 16-bit quantized GDVs. Halves signature memory, scores within 2e-3 of exact. Not supported with -a or -c alone", cmd, false);
+	TCLAP::ValueArg<unsigned int> threadsArg("t", "threads", "Number of threads. 0 = all cores. Default: 0", false, 0, "threads", cmd);
+	CacheArgs cacheArgs(cmd);
 
 	cmd.parse(argc, argv);
 
-	// Load graphs
-	std::cerr << "Loading graphs (1/2)";
-	Graph g1;
-	graph::readGraph(graph1Arg.getValue(), g1);
-	remove_edge_loops(g1);
-	std::vector<std::pair<size_t,size_t>> edges1;
-	get_edges(g1, edges1);
-
-	std::cerr << "\rLoading graphs (2/2)" << std::endl;
-	Graph g2;
-	graph::readGraph(graph2Arg.getValue(), g2);
-	remove_edge_loops(g2);
-	std::vector<std::pair<size_t,size_t>> edges2;
-	get_edges(g2, edges2);
-
-	// Compute GDVs
-	std::cerr << "Computing graphlet degree vectors (1/2)";
-	orca::Orca orca1(num_vertices(g1), edges1, graphletSizeArg.getValue());
-	orca1.compute();
-
-	std::cerr << "\rComputing graphlet degree vectors (2/2)" << std::endl;
-	orca::Orca orca2(num_vertices(g2), edges2, graphletSizeArg.getValue());
-	orca2.compute();
-
-	// Compute similarity matrix
-	std::cerr << "Computing similarity matrix" << std::endl;
-	boost::numeric::ublas::matrix<float> sim;
-	libgraphlet::similarity(orca1, orca2, sim);
-
-	// Write to file
-	std::ofstream file(outputArg.getValue());
-	for(size_t i = 0; i < num_vertices(g1); ++i) {
-		for(size_t j = 0; j < num_vertices(g2); ++j) {
-			file << boost::format("%s\t%s\t%f\n") % g1[i].label % g2[j].label % sim(i, j);
+	std::unique_ptr<orca::OrbitCache> cache = cacheArgs.open();
+
+	if(pairsArg.isSet() && topArg.getValue() > 0) {
+		std::cerr << "error: -p/--pairs cannot be combined with -k/--top" << std::endl;
+		return 1;
+	}
+	if(approxArg.isSet() && topArg.getValue() == 0) {
+		std::cerr << "error: -a/--approximate requires -k/--top" << std::endl;
+		return 1;
+	}
+	if(quantizeSwitch.getValue() && approxArg.isSet()) {
+		std::cerr << "error: -q/--quantize cannot be combined with -a/--approximate" << std::endl;
+		return 1;
+	}
+	if(quantizeSwitch.getValue() && cutoffArg.isSet() && topArg.getValue() == 0 && !pairsArg.isSet()) {
+		std::cerr << "error: -q/--quantize with -c/--cutoff requires -k/--top or -p/--pairs" << std::endl;
+		return 1;
+	}
+
+	if(!check_graphlet_sizes(graph1Arg.getValue(), graph2Arg.getValue(), graphletSizeArg)) {
+		return 1;
+	}
+
+	// Comparing a network to itself only needs one set of GDVs
+	const bool self = (graph1Arg.getValue() == graph2Arg.getValue());
+
+	// Load or count GDVs. The two networks are independent until compared,
+	// so the second is loaded and counted on its own thread meanwhile.
+	std::cerr << "Computing graphlet degree vectors" << std::endl;
+	std::vector<std::string> labels1, labels2;
+	std::future<std::unique_ptr<libgraphlet::PreparedSignature>> second;
+	if(!self) {
+		second = std::async(std::launch::async, load_signature,
+			graph2Arg.getValue(), graphletSizeArg.getValue(), threadsArg.getValue(), cache.get(), std::ref(labels2));
+	}
+	std::unique_ptr<libgraphlet::PreparedSignature> sig1ptr =
+		load_signature(graph1Arg.getValue(), graphletSizeArg.getValue(), threadsArg.getValue(), cache.get(), labels1);
+	std::unique_ptr<libgraphlet::PreparedSignature> sig2ptr;
+	if(!self) sig2ptr = second.get();
+	const std::vector<std::string> &names2 = self ? labels1 : labels2;
+
+	// Quantized signatures replace the float ones, which are released
+	std::unique_ptr<libgraphlet::QuantizedSignature> q1ptr, q2ptr;
+	if(quantizeSwitch.getValue()) {
+		q1ptr.reset(new libgraphlet::QuantizedSignature(*sig1ptr));
+		sig1ptr.reset();
+		if(!self) {
+			q2ptr.reset(new libgraphlet::QuantizedSignature(*sig2ptr));
+			sig2ptr.reset();
+		}
+	}
+	const libgraphlet::QuantizedSignature *q1 = q1ptr.get();
+	const libgraphlet::QuantizedSignature *q2 = self ? q1 : q2ptr.get();
+	const libgraphlet::PreparedSignature *sig1 = sig1ptr.get();
+	const libgraphlet::PreparedSignature *sig2 = self ? sig1 : sig2ptr.get();
+
+	if(topArg.getValue() > 0 || cutoffArg.isSet() || pairsArg.isSet()) {
+		std::vector<libgraphlet::Match> matches;
+		if(pairsArg.isSet()) {
+			// Compute listed pairs only
+			std::cerr << "Reading candidate pairs" << std::endl;
+			std::map<std::string,size_t> ids1, ids2;
+			for(size_t i = 0; i < labels1.size(); ++i) ids1[labels1[i]] = i;
+			for(size_t j = 0; j < names2.size(); ++j) ids2[names2[j]] = j;
+
+			std::ifstream pairsFile(pairsArg.getValue());
+			if(!pairsFile) {
+				std::cerr << "error: could not open " << pairsArg.getValue() << std::endl;
+				return 1;
+			}
+			std::string u, v;
+			size_t skipped = 0;
+			while(pairsFile >> u >> v) {
+				auto it1 = ids1.find(u);
+				auto it2 = ids2.find(v);
+				if(it1 == ids1.end() || it2 == ids2.end()) {
+					++skipped;
+					continue;
+				}
+				libgraphlet::Match m = { it1->second, it2->second, 0.0f };
+				matches.push_back(m);
+			}
+			if(skipped > 0) {
+				std::cerr << "Skipped " << skipped << " pairs with unknown nodes" << std::endl;
+			}
+
+			std::cerr << "Computing similarity of " << matches.size() << " pairs" << std::endl;
+			if(q1) libgraphlet::similarity_pairs(*q1, *q2, matches, threadsArg.getValue());
+			else libgraphlet::similarity_pairs(*sig1, *sig2, matches, threadsArg.getValue());
+		} else if(topArg.getValue() > 0) {
+			// Compute best matches only
+			if(approxArg.isSet()) {
+				std::cerr << "Building nearest neighbour index" << std::endl;
+				libgraphlet::GDVIndex index(*sig2);
+
+				std::cerr << "Querying top " << topArg.getValue() << " matches" << std::endl;
+				index.query(*sig1, topArg.getValue(), matches, approxArg.getValue(), threadsArg.getValue());
+			} else {
+				std::cerr << "Computing top " << topArg.getValue() << " matches" << std::endl;
+				if(q1) libgraphlet::similarity_topk(*q1, *q2, topArg.getValue(), matches, threadsArg.getValue());
+				else libgraphlet::similarity_topk(*sig1, *sig2, topArg.getValue(), matches, threadsArg.getValue());
+			}
+		} else {
+			// Compute pairs above cutoff only
+			std::cerr << "Computing pairs with similarity >= " << cutoffArg.getValue() << std::endl;
+			libgraphlet::similarity_threshold(*sig1, *sig2, cutoffArg.getValue(), matches, threadsArg.getValue());
+		}
+
+		if(cutoffArg.isSet()) {
+			float cutoff = cutoffArg.getValue();
+			matches.erase(std::remove_if(matches.begin(), matches.end(), [cutoff](const libgraphlet::Match &m) {
+				return m.score < cutoff;
+			}), matches.end());
+		}
+
+		// Write to file
+		write_rows(outputArg.getValue(), matches.size(), [&](size_t k, std::string &out) {
+			const libgraphlet::Match &m = matches[k];
+			out.append(labels1[m.i]);
+			out.push_back('\t');
+			out.append(names2[m.j]);
+			out.push_back('\t');
+			append_fixed(out, m.score);
+			out.push_back('\n');
+		}, threadsArg.getValue(), 4096);
+	} else if(blockArg.isSet()) {
+		// Compute similarity matrix into a binary file block by block
+		std::cerr << "Computing similarity matrix in blocks of " << blockArg.getValue() << " rows" << std::endl;
+
+		if(q1) {
+			libgraphlet::similarity_file(*q1, *q2, outputArg.getValue(), blockArg.getValue(), threadsArg.getValue());
+		} else {
+			libgraphlet::similarity_file(*sig1, *sig2, outputArg.getValue(), blockArg.getValue(), threadsArg.getValue());
+		}
+	} else {
+		// Compute similarity matrix
+		std::cerr << "Computing similarity matrix" << std::endl;
+		boost::numeric::ublas::matrix<float> sim;
+		if(q1) {
+			libgraphlet::similarity(*q1, *q2, sim, threadsArg.getValue());
+		} else {
+			libgraphlet::similarity(*sig1, *sig2, sim, threadsArg.getValue());
 		}
+
+		// Write to file
+		write_rows(outputArg.getValue(), labels1.size(), [&](size_t i, std::string &out) {
+			for(size_t j = 0; j < names2.size(); ++j) {
+				out.append(labels1[i]);
+				out.push_back('\t');
+				out.append(names2[j]);
+				out.push_back('\t');
+				append_fixed(out, sim(i, j));
+				out.push_back('\n');
+			}
+		}, threadsArg.getValue(), 1);
 	}
-	file.close();
 
 	std::cerr << "Done!" << std::endl;
 
@@ -0,0 +1,118 @@
+#include <fstream>
+#include <map>
+#include <memory>
+#include <tclap/CmdLine.h>
+#include <orca/OrbitCache.hpp>
+#include <orca/Parallel.hpp>
+#include <libgraphlet/Batch.hpp>
+#include "Graph.hpp"
+#include "Signature.hpp"
+#include "Output.hpp"
+
+namespace {
+	void read_list(const std::string &path, std::vector<std::string> &out) {
+		std::ifstream file(path);
+		if(!file) throw std::runtime_error("Could not open " + path);
+		std::string line;
+		while(file >> line) out.push_back(line);
+	}
+}
+
+int main(int argc, const char **argv) {
+	TCLAP::CmdLine cmd(
+		"gdv_similarity_batch",
+		"Compute GDV similarity of every query network against every reference network.",
+		"0.1",
+		"Simon Larsen <simonhffh@gmail.com>"
+	);
+
+	TCLAP::ValueArg<int> graphletSizeArg("s", "size", "Graphlet size. 2-5 supported. Default: 4", false, 4, "size", cmd);
+	TCLAP::UnlabeledValueArg<std::string> queriesArg("queries", "File listing paths of query graphs or binary GDV files, one per line", true, "", "FILE", cmd);
+	TCLAP::UnlabeledValueArg<std::string> referencesArg("references", "File listing paths of reference graphs or binary GDV files, one per line", true, "", "FILE", cmd);
+	TCLAP::UnlabeledValueArg<std::string> outputArg("output", "Output file", true, "", "FILE", cmd);
+	TCLAP::ValueArg<size_t> topArg("k", "top", "Only output the k most similar reference nodes for each query node. 0 = all. Default: 0", false, 0, "k", cmd);
+	TCLAP::ValueArg<float> cutoffArg("c", "cutoff", "Only output pairs with similarity at least the cutoff", false, 0.0f, "cutoff", cmd);
+	TCLAP::ValueArg<unsigned int> threadsArg("t", "threads", "Number of threads. 0 = all cores. Default: 0", false, 0, "threads", cmd);
+	CacheArgs cacheArgs(cmd);
+
+	cmd.parse(argc, argv);
+
+	std::unique_ptr<orca::OrbitCache> cache = cacheArgs.open();
+
+	std::vector<std::string> queries, references;
+	read_list(queriesArg.getValue(), queries);
+	read_list(referencesArg.getValue(), references);
+
+	// Every distinct network is loaded and counted once
+	std::vector<std::string> paths;
+	std::map<std::string,size_t> index;
+	for(auto *list : { &queries, &references }) {
+		for(auto &path : *list) {
+			if(index.insert(std::make_pair(path, paths.size())).second) {
+				paths.push_back(path);
+			}
+		}
+	}
+
+	if(!check_graphlet_sizes(paths, graphletSizeArg)) {
+		return 1;
+	}
+
+	std::ofstream file(outputArg.getValue(), std::ios::binary);
+	if(!file) {
+		std::cerr << "error: could not open " << outputArg.getValue() << std::endl;
+		return 1;
+	}
+
+	std::cerr << "Computing graphlet degree vectors of " << paths.size() << " networks" << std::endl;
+	std::vector<std::unique_ptr<libgraphlet::PreparedSignature>> sigs(paths.size());
+	std::vector<std::vector<std::string>> labels(paths.size());
+	orca::parallel_for(0, paths.size(), [&](size_t p) {
+		sigs[p] = load_signature(paths[p], graphletSizeArg.getValue(), 1, cache.get(), labels[p]);
+	}, threadsArg.getValue(), 1);
+
+	libgraphlet::SignatureStore store;
+	for(size_t p = 0; p < paths.size(); ++p) {
+		store.add(paths[p], std::move(*sigs[p]), std::move(labels[p]));
+		sigs[p].reset();
+	}
+
+	std::vector<libgraphlet::BatchJob> jobs;
+	for(auto &q : queries) {
+		for(auto &r : references) {
+			libgraphlet::BatchJob job = { index[q], index[r] };
+			jobs.push_back(job);
+		}
+	}
+
+	// Results are written as each job finishes
+	std::cerr << "Running " << jobs.size() << " similarity jobs" << std::endl;
+	std::string text;
+	libgraphlet::similarity_batch(store, jobs, topArg.getValue(), cutoffArg.getValue(),
+		[&](size_t t, std::vector<libgraphlet::Match> &matches) {
+			const libgraphlet::BatchJob &job = jobs[t];
+			const std::string &na = store.name(job.a), &nb = store.name(job.b);
+			const std::vector<std::string> &la = store.labels(job.a), &lb = store.labels(job.b);
+			text.clear();
+			for(auto &m : matches) {
+				text.append(na).push_back('\t');
+				text.append(nb).push_back('\t');
+				text.append(la[m.i]).push_back('\t');
+				text.append(lb[m.j]).push_back('\t');
+				append_fixed(text, m.score);
+				text.push_back('\n');
+			}
+			file.write(text.data(), text.size());
+		},
+		threadsArg.getValue()
+	);
+	file.close();
+	if(!file) {
+		std::cerr << "error: could not write " << outputArg.getValue() << std::endl;
+		return 1;
+	}
+
+	std::cerr << "Done!" << std::endl;
+
+	return 0;
+}
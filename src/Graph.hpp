@@ -2,8 +2,16 @@
 #define ORCA_GRAPH_HPP 
 
 #include <graph/Graph.hpp>
+#include <graph/GraphReader.hpp>
+#include <tclap/CmdLine.h>
+#include <orca/EdgeList.hpp>
+#include <orca/OrbitCache.hpp>
+#include <orca/GDVFile.hpp>
 #include <vector>
+#include <string>
+#include <memory>
 #include <utility>
+#include <algorithm>
 
 typedef typename boost::adjacency_list<
 	boost::setS,
@@ -36,4 +44,109 @@ inline void remove_edge_loops(G &g) {
 	);
 }
 
+/**
+ * Loads a graph for counting. Plain edge lists are read by the native
+ * parallel loader; GraphML, GML and SIF files are read through libgraph.
+ */
+inline void load_graph(const std::string &path, orca::EdgeList &out, unsigned int threads = 0) {
+	static const char *formats[] = { ".graphml", ".xml", ".gml", ".sif" };
+	for(const char *ext : formats) {
+		const size_t len = std::char_traits<char>::length(ext);
+		if(path.size() < len || path.compare(path.size() - len, len, ext) != 0) continue;
+
+		Graph g;
+		graph::readGraph(path, g);
+		remove_edge_loops(g);
+		get_edges(g, out.edges);
+		for(auto &e : out.edges) {
+			if(e.first > e.second) std::swap(e.first, e.second);
+		}
+		std::sort(out.edges.begin(), out.edges.end());
+		out.edges.erase(std::unique(out.edges.begin(), out.edges.end()), out.edges.end());
+
+		out.labels.clear();
+		for(size_t i = 0; i < num_vertices(g); ++i) {
+			out.labels.push_back(g[i].label);
+		}
+		return;
+	}
+
+	orca::read_edge_list(path, out, threads);
+}
+
+/**
+ * Graphlet size of the orbits of an input: the size a binary GDV file
+ * was counted with, otherwise graphlet_size, which a graph is counted
+ * with.
+ */
+inline int input_graphlet_size(const std::string &path, int graphlet_size) {
+	if(!orca::is_gdv_file(path)) return graphlet_size;
+	return orca::GDVFile(path).graphletSize();
+}
+
+/**
+ * Checks that two inputs have GDVs of the same graphlet size, and of the
+ * size given with -s if it was set, before anything is counted. Prints
+ * an error and returns false otherwise.
+ */
+inline bool check_graphlet_sizes(
+	const std::string &path1,
+	const std::string &path2,
+	const TCLAP::ValueArg<int> &graphletSizeArg
+) {
+	const int size = graphletSizeArg.getValue();
+	const int size1 = input_graphlet_size(path1, size);
+	const int size2 = input_graphlet_size(path2, size);
+	if(size1 == size2 && (!graphletSizeArg.isSet() || size1 == size)) return true;
+
+	std::cerr << "error: graphlet sizes do not match: " << path1 << " has size " << size1
+		<< ", " << path2 << " has size " << size2 << ", -s is " << size
+		<< ". Binary GDV files keep the size they were counted with." << std::endl;
+	return false;
+}
+
+/**
+ * Checks that all inputs have GDVs of the same graphlet size, and of the
+ * size given with -s if it was set. Prints an error naming the first
+ * input and the first one that differs and returns false otherwise.
+ */
+inline bool check_graphlet_sizes(
+	const std::vector<std::string> &paths,
+	const TCLAP::ValueArg<int> &graphletSizeArg
+) {
+	for(size_t i = 0; i < paths.size(); ++i) {
+		if(!check_graphlet_sizes(paths.front(), paths[i], graphletSizeArg)) return false;
+	}
+	return true;
+}
+
+/**
+ * The -C/--cache and -L/--cache-limit options of the orbit count cache.
+ * Commands that stream the counts without keeping the signature pass
+ * stores = false: they read the cache but do not fill it.
+ */
+struct CacheArgs {
+	TCLAP::ValueArg<std::string> dir;
+	TCLAP::ValueArg<size_t> limit;
+
+	explicit CacheArgs(TCLAP::CmdLine &cmd, bool stores = true)
+	: dir("C", "cache", stores
+		? "Reuse orbit counts cached in this directory, counting and storing them on a miss"
+		: "Reuse orbit counts cached in this directory. Misses are counted but not stored; fill the cache with gdv -C",
+		false, "", "DIR", cmd)
+	, limit("L", "cache-limit", "Size limit of the orbit count cache in MiB. 0 = unlimited. Default: 0", false, 0, "MiB", cmd)
+	{ }
+
+	/**
+	 * The cache given on the command line, or null if none was.
+	 */
+	std::unique_ptr<orca::OrbitCache> open() const {
+		std::unique_ptr<orca::OrbitCache> cache;
+		if(dir.isSet()) {
+			cache.reset(new orca::OrbitCache(dir.getValue(), limit.getValue() << 20));
+		}
+		return cache;
+	}
+};
+
 #endif
@@ -0,0 +1,139 @@
+#ifndef ORCA_OUTPUT_HPP
+#define ORCA_OUTPUT_HPP
+
+#include <cstdio>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <orca/Parallel.hpp>
+
+/**
+ * Appends v in decimal.
+ */
+inline void append_int(std::string &out, int64_t v) {
+	char buf[24];
+	char *end = buf + sizeof(buf), *p = end;
+	uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+	do {
+		*--p = '0' + (char)(u % 10);
+		u /= 10;
+	} while(u > 0);
+	if(v < 0) *--p = '-';
+	out.append(p, end - p);
+}
+
+/**
+ * Appends v with six decimals, exactly as printf("%f") does.
+ * v * 10^6 is exact in double precision for any float below 2^33, so
+ * rounding it to an integer reproduces printf's round-half-even on the
+ * exact binary value. Other values fall back to snprintf.
+ */
+inline void append_fixed(std::string &out, float v) {
+	double d = std::fabs((double)v);
+	if(!(d < 8589934592.0)) {
+		char buf[64];
+		int len = snprintf(buf, sizeof(buf), "%f", (double)v);
+		out.append(buf, len);
+		return;
+	}
+
+	uint64_t r = (uint64_t)std::nearbyint(d * 1e6);
+	if(std::signbit(v)) out.push_back('-');
+	append_int(out, (int64_t)(r / 1000000));
+
+	char frac[7];
+	uint64_t f = r % 1000000;
+	frac[0] = '.';
+	for(int i = 6; i >= 1; --i) {
+		frac[i] = '0' + (char)(f % 10);
+		f /= 10;
+	}
+	out.append(frac, 7);
+}
+
+/**
+ * Appends v in the shortest of fixed and scientific notation with six
+ * significant digits, as std::ostream prints floats by default.
+ */
+inline void append_general(std::string &out, float v) {
+	if(v == 0.0f && !std::signbit(v)) {
+		out.push_back('0');
+		return;
+	}
+	char buf[32];
+	int len = snprintf(buf, sizeof(buf), "%g", (double)v);
+	out.append(buf, len);
+}
+
+/**
+ * Writes rows of text to path. format(i, out) appends row i to out.
+ *
+ * Rows are formatted in blocks of block_rows by the given number of
+ * threads (0 = all cores) into per-block buffers. Blocks are written in
+ * order by a background thread while the next batch of blocks is
+ * formatted, so the file is identical to formatting the rows in turn.
+ * Throws std::runtime_error if the file cannot be written.
+ */
+template<typename F>
+inline void write_rows(
+	const std::string &path,
+	size_t rows,
+	F format,
+	unsigned int threads = 0,
+	size_t block_rows = 1024
+) {
+	FILE *file = fopen(path.c_str(), "wb");
+	if(!file) {
+		throw std::runtime_error("Could not open " + path + " for writing.");
+	}
+
+	if(threads == 0) threads = orca::default_threads();
+	if(block_rows == 0) block_rows = 1;
+	const size_t blocks = (rows + block_rows - 1) / block_rows;
+	const size_t batch = 4 * threads;
+
+	// Double buffering: batch k is formatted while batch k-1 is written
+	std::vector<std::string> buffers[2];
+	buffers[0].resize(batch);
+	buffers[1].resize(batch);
+
+	std::thread writer;
+	bool ok = true, write_ok = true;
+	try {
+		for(size_t k = 0, b0 = 0; b0 < blocks && ok; ++k, b0 += batch) {
+			const size_t b1 = std::min(b0 + batch, blocks);
+			std::vector<std::string> &bufs = buffers[k % 2];
+			orca::parallel_for(b0, b1, [&](size_t b) {
+				std::string &s = bufs[b - b0];
+				s.clear();
+				size_t end = std::min((b+1) * block_rows, rows);
+				for(size_t i = b * block_rows; i < end; ++i) format(i, s);
+			}, threads, 1);
+
+			if(writer.joinable()) writer.join();
+			ok = write_ok;
+
+			const size_t count = b1 - b0;
+			writer = std::thread([&bufs, count, file, &write_ok]() {
+				for(size_t b = 0; b < count && write_ok; ++b) {
+					write_ok = fwrite(bufs[b].data(), 1, bufs[b].size(), file) == bufs[b].size();
+				}
+			});
+		}
+	} catch(...) {
+		if(writer.joinable()) writer.join();
+		fclose(file);
+		throw;
+	}
+	if(writer.joinable()) writer.join();
+	ok = ok && write_ok;
+
+	if(fclose(file) != 0 || !ok) {
+		throw std::runtime_error("Error writing " + path + ".");
+	}
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef ORCA_SIGNATURE_HPP
+#define ORCA_SIGNATURE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <orca/Orca.hpp>
+#include <orca/OrbitCache.hpp>
+#include <orca/GDVFile.hpp>
+#include <libgraphlet/Similarity.hpp>
+#include "Graph.hpp"
+
+/**
+ * Prepares the stored GDVs of a binary GDV file, or loads a graph and
+ * counts its orbits. Nodes of GDV files without labels are named by
+ * index.
+ */
+inline std::unique_ptr<libgraphlet::PreparedSignature> load_signature(
+	const std::string &path,
+	int graphlet_size,
+	unsigned int threads,
+	const orca::OrbitCache *cache,
+	std::vector<std::string> &labels
+) {
+	if(orca::is_gdv_file(path)) {
+		orca::GDVFile gdv(path);
+		labels = gdv.labels();
+		if(labels.empty()) {
+			for(size_t i = 0; i < gdv.size(); ++i) labels.push_back(std::to_string(i));
+		}
+		return std::unique_ptr<libgraphlet::PreparedSignature>(new libgraphlet::PreparedSignature(gdv));
+	}
+
+	orca::EdgeList g;
+	load_graph(path, g, threads);
+	labels = std::move(g.labels);
+	orca::Orca orca(labels.size(), std::move(g.edges), graphlet_size, true);
+	orca.setThreads(threads);
+	orca.setOrbitCache(cache);
+	orca.compute();
+	return std::unique_ptr<libgraphlet::PreparedSignature>(new libgraphlet::PreparedSignature(orca));
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include <cmath>
+#include <random>
+#include <string>
+#include <iostream>
+#include <boost/compute/core.hpp>
+#include <orca/Orca.hpp>
+#include <libgraphlet/Similarity.hpp>
+#include <libgraphlet/SimilarityGPU.hpp>
+
+namespace {
+	// Largest accepted difference between device and host scores
+	const float TOLERANCE = 1e-5f;
+
+	// Exit code telling ctest the check was skipped
+	const int SKIPPED = 77;
+
+	// Random counts spread over several orders of magnitude, with zeros
+	std::vector<int64_t> random_counts(size_t n, size_t orbits, std::mt19937 &rng) {
+		std::uniform_int_distribution<int> exponent(-2, 6);
+		std::uniform_real_distribution<double> mantissa(1.0, 10.0);
+		std::vector<int64_t> data(n * orbits);
+		for(int64_t &x : data) {
+			int e = exponent(rng);
+			x = e < 0 ? 0 : (int64_t)(mantissa(rng) * std::pow(10.0, e));
+		}
+		return data;
+	}
+
+	bool compare(
+		const std::string &name,
+		const boost::numeric::ublas::matrix<float> &expected,
+		const boost::numeric::ublas::matrix<float> &actual
+	) {
+		if(expected.size1() != actual.size1() || expected.size2() != actual.size2()) {
+			std::cerr << "FAIL " << name << " (wrong dimensions)" << std::endl;
+			return false;
+		}
+		float maxdiff = 0.0f;
+		for(size_t i = 0; i < expected.size1(); ++i) {
+			for(size_t j = 0; j < expected.size2(); ++j) {
+				maxdiff = std::max(maxdiff, std::fabs(expected(i, j) - actual(i, j)));
+			}
+		}
+		bool ok = maxdiff <= TOLERANCE;
+		std::cerr << (ok ? "OK   " : "FAIL ") << name << " (max difference " << maxdiff << ")" << std::endl;
+		return ok;
+	}
+}
+
+/**
+ * Compares SimilarityEngine on the default OpenCL device with the CPU
+ * similarity(), with default tiles and with tiles small enough that
+ * the matrix spans many of them in both dimensions.
+ */
+int main() {
+	boost::compute::device device;
+	try {
+		device = boost::compute::system::default_device();
+	} catch(const std::exception &e) {
+		std::cerr << "No OpenCL device, skipping: " << e.what() << std::endl;
+		return SKIPPED;
+	}
+	std::cerr << "Device: " << device.name() << std::endl;
+
+	// One engine serves both graphlet sizes, so its buffers are
+	// reallocated when the stride changes. 301 x 203 in 7 x 33 tiles has
+	// partial tiles on both edges and both slots in flight over every
+	// tile of b.
+	libgraphlet::SimilarityEngine engine(device, 7, 33);
+
+	std::mt19937 rng(1);
+	bool ok = true;
+	for(int size : { 4, 5 }) {
+		const std::string prefix = "size " + std::to_string(size) + ", ";
+		const size_t orbits = orca::ORBITS[size];
+		std::vector<int64_t> da = random_counts(301, orbits, rng);
+		std::vector<int64_t> db = random_counts(203, orbits, rng);
+		libgraphlet::PreparedSignature a(da.data(), 301, orbits, orbits);
+		libgraphlet::PreparedSignature b(db.data(), 203, orbits, orbits);
+
+		boost::numeric::ublas::matrix<float> expected, actual;
+		libgraphlet::similarity(a, b, expected, 1);
+
+		libgraphlet::similarityGPU(a, b, actual, device);
+		ok = compare(prefix + "one tile", expected, actual) && ok;
+
+		engine.similarity(a, b, actual);
+		ok = compare(prefix + "43 x 7 tiles", expected, actual) && ok;
+
+		libgraphlet::similarity(b, a, expected, 1);
+		engine.similarity(b, a, actual);
+		ok = compare(prefix + "29 x 10 tiles, swapped", expected, actual) && ok;
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#include <libgraphlet/Batch.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <orca/Parallel.hpp>
+
+namespace {
+	// Rows of a per emitted block
+	const size_t BLOCK_ROWS = 128;
+}
+
+namespace libgraphlet {
+	size_t SignatureStore::add(
+		const std::string &name,
+		PreparedSignature &&sig,
+		std::vector<std::string> labels
+	) {
+		if(!labels.empty() && labels.size() != sig.size()) {
+			throw std::invalid_argument("Number of labels does not match number of nodes.");
+		}
+		std::unique_ptr<Entry> entry(new Entry{ name, std::move(sig), std::move(labels) });
+
+		std::lock_guard<std::mutex> lock(mutex);
+		entries.push_back(std::move(entry));
+		return entries.size() - 1;
+	}
+
+	size_t SignatureStore::add(
+		const std::string &name,
+		const orca::Orca &orca,
+		std::vector<std::string> labels
+	) {
+		return add(name, PreparedSignature(orca), std::move(labels));
+	}
+
+	size_t SignatureStore::size() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return entries.size();
+	}
+
+	const SignatureStore::Entry &SignatureStore::entry(size_t i) const {
+		// The vector may reallocate during add, the entries themselves do not
+		std::lock_guard<std::mutex> lock(mutex);
+		return *entries[i];
+	}
+
+	void similarity_batch(
+		const SignatureStore &store,
+		const std::vector<BatchJob> &jobs,
+		size_t k,
+		float cutoff,
+		const std::function<void(size_t, std::vector<Match>&)> &emit,
+		unsigned int threads
+	) {
+		const size_t n = store.size();
+		for(const BatchJob &job : jobs) {
+			if(job.a >= n || job.b >= n) {
+				throw std::invalid_argument("Job refers to network not in store.");
+			}
+		}
+
+		// Jobs run single-threaded side by side, which keeps every core
+		// busy without splitting small matrices into tiny tasks
+		std::mutex emit_mutex;
+		orca::parallel_for(0, jobs.size(), [&](size_t t) {
+			const PreparedSignature &a = store.signature(jobs[t].a);
+			const PreparedSignature &b = store.signature(jobs[t].b);
+
+			std::vector<Match> matches;
+			for(size_t i0 = 0; i0 < a.size(); i0 += BLOCK_ROWS) {
+				size_t i1 = std::min(i0 + BLOCK_ROWS, a.size());
+				if(k > 0) {
+					similarity_topk_rows(a, b, i0, i1, k, matches, 1);
+				} else {
+					similarity_threshold_rows(a, b, i0, i1, cutoff, matches, 1);
+				}
+				matches.erase(std::remove_if(matches.begin(), matches.end(), [cutoff](const Match &m) {
+					return m.score < cutoff;
+				}), matches.end());
+
+				std::lock_guard<std::mutex> lock(emit_mutex);
+				emit(t, matches);
+			}
+		}, threads, 1);
+	}
+}
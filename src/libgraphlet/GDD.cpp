@@ -1,48 +1,178 @@
 #include <iostream>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
 #include <stdexcept>
+#include <unordered_map>
 #include <libgraphlet/GDD.hpp>
+#include <orca/Parallel.hpp>
+
+namespace {
+	// Degrees below this are counted in dense arrays
+	const size_t DENSE_LIMIT = 1024;
+
+	// Per-part orbit degree counts. Each part is filled by one thread at
+	// a time: small degrees densely, larger ones by distinct value.
+	struct HistogramParts {
+		size_t orbits;
+		std::vector<std::vector<uint64_t>> dense;
+		std::vector<std::vector<std::unordered_map<uint64_t, uint64_t>>> large;
+
+		HistogramParts(size_t parts, size_t orbits)
+		: orbits(orbits)
+		, dense(parts, std::vector<uint64_t>(orbits * DENSE_LIMIT, 0))
+		, large(parts, std::vector<std::unordered_map<uint64_t, uint64_t>>(orbits))
+		{ }
+
+		void add(size_t p, const int64_t *row) {
+			for(size_t j = 0; j < orbits; ++j) {
+				uint64_t k = (uint64_t)row[j];
+				if(k < DENSE_LIMIT) {
+					dense[p][j*DENSE_LIMIT + k]++;
+				} else {
+					large[p][j][k]++;
+				}
+			}
+		}
 
-namespace libgraphlet {
-	void gdd(
-		const orca::Orca &orca,
-		GDD &gdd,
-		bool normalize
-	) {
-		int orbits = orca::ORBITS[orca.graphletSize()];
+		void merge(libgraphlet::GDDHistogram &hist, unsigned int threads) const {
+			hist.clear();
+			hist.resize(orbits);
+			orca::parallel_for(0, orbits, [&](size_t j) {
+				libgraphlet::OrbitHistogram &h = hist[j];
+				h.dense.assign(DENSE_LIMIT, 0);
+				std::unordered_map<uint64_t, uint64_t> tail;
+				for(size_t p = 0; p < dense.size(); ++p) {
+					for(size_t k = 1; k < DENSE_LIMIT; ++k) {
+						h.dense[k] += dense[p][j*DENSE_LIMIT + k];
+					}
+					for(auto &it : large[p][j]) tail[it.first] += it.second;
+				}
 
-		gdd.clear();
-		gdd.resize(orbits);
+				size_t last = DENSE_LIMIT;
+				while(last > 1 && h.dense[last-1] == 0) --last;
+				h.dense.resize(last);
 
-		auto &sig = orca.getOrbits();
+				h.tail.assign(tail.begin(), tail.end());
+				std::sort(h.tail.begin(), h.tail.end());
+			}, threads, 1);
+		}
+	};
+
+	// Agreement of one orbit, merging the sorted distributions. Terms
+	// are summed in order of increasing degree, skipping degree 0.
+	template<typename V>
+	float orbit_agreement(const V &a, const V &b) {
+		auto ia = a.begin(), ib = b.begin();
+		while(ia != a.end() && ia->first == 0) ++ia;
+		while(ib != b.end() && ib->first == 0) ++ib;
+
+		float sum = 0.0f;
+		while(ia != a.end() || ib != b.end()) {
+			float d;
+			if(ib == b.end() || (ia != a.end() && ia->first < ib->first)) {
+				d = ia->second;
+				++ia;
+			} else if(ia == a.end() || ib->first < ia->first) {
+				d = -ib->second;
+				++ib;
+			} else {
+				d = ia->second - ib->second;
+				++ia;
+				++ib;
+			}
+			sum += std::pow(d, 2.0f);
+		}
+
+		return 1.0f - std::sqrt(sum) / std::sqrt(2.0f);
+	}
+
+	template<typename G>
+	void agreement(const G &a, const G &b, std::vector<float> &out) {
+		if(a.size() != b.size()) {
+			throw std::invalid_argument("GDDs not of same size");
+		}
 
-		// Calculate degree distributions
-		for(auto it1 = sig.begin1(); it1 != sig.end1(); ++it1) {
-			size_t j = 0;
-			for(auto it = it1.begin(); it != it1.end(); ++it, ++j) {
-				auto k = *it;
+		out.resize(a.size());
+		for(size_t i = 0; i < a.size(); ++i) {
+			out[i] = orbit_agreement(a[i], b[i]);
+		}
+	}
+}
 
-				if(k == 0) continue;
+namespace libgraphlet {
+	void gdd_histogram(
+		const orca::Orca &orca,
+		GDDHistogram &hist,
+		unsigned int threads
+	) {
+		const orca::Signature &sig = orca.getOrbits();
+		const size_t n = sig.size1();
+		gdd_histogram(n > 0 ? &(sig.data()[0]) : nullptr, n, orca::ORBITS[orca.graphletSize()], sig.size2(), hist, threads);
+	}
 
-				if(gdd[j].find(k) == gdd[j].end()) {
-					gdd[j][k] = 0.0f;
-				}
+	void gdd_histogram(
+		const orca::GDVFile &file,
+		GDDHistogram &hist,
+		unsigned int threads
+	) {
+		gdd_histogram(file.data(), file.size(), file.orbits(), file.stride(), hist, threads);
+	}
 
-				gdd[j][k] += 1.0f;
+	void gdd_histogram(
+		const int64_t *data,
+		size_t n,
+		size_t orbits,
+		size_t cols,
+		GDDHistogram &hist,
+		unsigned int threads
+	) {
+		if(threads == 0) threads = orca::default_threads();
+		const size_t parts = std::max<size_t>(1, std::min<size_t>(threads, n / DENSE_LIMIT));
+
+		HistogramParts counts(parts, orbits);
+		orca::parallel_for(0, parts, [&](size_t p) {
+			size_t begin = n * p / parts, end = n * (p+1) / parts;
+			for(size_t i = begin; i < end; ++i) {
+				counts.add(p, data + i*cols);
 			}
-		}
+		}, threads, 1);
+		counts.merge(hist, threads);
+	}
 
-		if(normalize) {
-			// Scale by k
-			for(auto &v : gdd) {
-				for(auto &it : v) {
-					if(it.first > 0) {
-						it.second /= (float)it.first;
-					}
+	void count_gdd_histogram(
+		orca::Orca &orca,
+		GDDHistogram &hist
+	) {
+		const size_t orbits = orca::ORBITS[orca.graphletSize()];
+		HistogramParts counts(orca.workers(), orbits);
+		orca.compute([&](unsigned int worker, size_t, const int64_t *row) {
+			counts.add(worker, row);
+		});
+		counts.merge(hist, orca.workers());
+	}
+
+	void gdd(
+		const GDDHistogram &hist,
+		SparseGDD &gdd,
+		bool normalize
+	) {
+		gdd.clear();
+		gdd.resize(hist.size());
+
+		for(size_t j = 0; j < hist.size(); ++j) {
+			auto &v = gdd[j];
+			hist[j].for_each([&](uint64_t k, uint64_t count) {
+				float value = (float)count;
+				if(normalize) {
+					// Scale by k
+					value /= (float)k;
 				}
-			}
+				v.push_back(std::make_pair(k, value));
+			});
 
-			// Normalize to [0,1]
-			for(auto &v : gdd) {
+			if(normalize) {
+				// Normalize to [0,1]
 				float sum = 0.0f;
 				for(auto &it : v) {
 					sum += it.second;
@@ -55,6 +185,34 @@ namespace libgraphlet {
 		}
 	}
 
+	void gdd(
+		const GDDHistogram &hist,
+		GDD &out,
+		bool normalize
+	) {
+		SparseGDD sparse;
+		gdd(hist, sparse, normalize);
+
+		out.clear();
+		out.resize(sparse.size());
+		for(size_t j = 0; j < sparse.size(); ++j) {
+			for(auto &it : sparse[j]) {
+				out[j].emplace_hint(out[j].end(), (size_t)it.first, it.second);
+			}
+		}
+	}
+
+	void gdd(
+		const orca::Orca &orca,
+		GDD &out,
+		bool normalize,
+		unsigned int threads
+	) {
+		GDDHistogram hist;
+		gdd_histogram(orca, hist, threads);
+		gdd(hist, out, normalize);
+	}
+
 	/**
 	 * Calculates the GDD-agreement vector of two GDDs.
 	 * Note: GDDs must be normalized!
@@ -64,34 +222,33 @@ namespace libgraphlet {
 		const GDD &b,
 		std::vector<float> &out
 	) {
-		if(a.size() != b.size()) {
-			throw std::invalid_argument("GDDs not of same size");
-		}
-
-		size_t n = a.size();
-		out.resize(n);
-
-		for(size_t i = 0; i < n; ++i) {
-			size_t a_max = (a[i].size() > 0 ? a[i].rbegin()->first : 0);
-			size_t b_max = (b[i].size() > 0 ? b[i].rbegin()->first : 0);
-			size_t m = std::max(a_max, b_max);
-
-			float sum = 0.0f;
-			for(size_t j = 1; j <= m; ++j) {
-				float a_value = 0.0f;
-				float b_value = 0.0f;
+		agreement(a, b, out);
+	}
 
-				if(a[i].find(j) != a[i].end()) {
-					a_value = a[i].at(j);
-				}
-				if(b[i].find(j) != b[i].end()) {
-					b_value = b[i].at(j);
-				}
+	void gdd_agreement(
+		const SparseGDD &a,
+		const SparseGDD &b,
+		std::vector<float> &out
+	) {
+		agreement(a, b, out);
+	}
 
-				sum += std::pow(a_value - b_value, 2.0f);
+	void gdd_agreement_matrix(
+		const std::vector<SparseGDD> &gdds,
+		boost::numeric::ublas::matrix<float> &out,
+		unsigned int threads
+	) {
+		const size_t n = gdds.size();
+		out.resize(n, n, false);
+
+		orca::parallel_for(0, n, [&](size_t i) {
+			out(i, i) = 1.0f;
+			std::vector<float> v;
+			for(size_t j = i+1; j < n; ++j) {
+				agreement(gdds[i], gdds[j], v);
+				float mean = std::accumulate(v.begin(), v.end(), 0.0f) / (float)v.size();
+				out(i, j) = out(j, i) = mean;
 			}
-
-			out[i] = 1.0f - std::sqrt(sum) / std::sqrt(2.0f);
-		}
+		}, threads, 1);
 	}
 }
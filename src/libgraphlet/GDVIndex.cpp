@@ -0,0 +1,175 @@
+#include <libgraphlet/GDVIndex.hpp>
+
+#include <queue>
+#include <unordered_set>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <orca/Parallel.hpp>
+
+namespace {
+	inline bool better(const libgraphlet::Match &x, const libgraphlet::Match &y) {
+		if(x.score != y.score) return x.score > y.score;
+		return x.j < y.j;
+	}
+}
+
+namespace libgraphlet {
+	GDVIndex::GDVIndex(
+		const PreparedSignature &sig,
+		size_t trees,
+		size_t leaf_size,
+		unsigned int seed
+	)
+	: sig(sig)
+	, leaf_size(std::max<size_t>(leaf_size, 1))
+	{
+		const size_t n = sig.size();
+		std::mt19937 rng(seed);
+
+		items.resize(n * trees);
+		for(size_t t = 0; t < trees; ++t) {
+			for(size_t i = 0; i < n; ++i) {
+				items[t*n + i] = i;
+			}
+			roots.push_back(build(t*n, (t+1)*n, rng));
+		}
+	}
+
+	size_t GDVIndex::build(size_t begin, size_t end, std::mt19937 &rng) {
+		Node node;
+		node.leaf = (end - begin <= leaf_size);
+		node.begin = begin;
+		node.end = end;
+		node.left = node.right = 0;
+		node.normal = 0;
+		node.offset = 0.0f;
+
+		size_t id = nodes.size();
+		if(node.leaf) {
+			nodes.push_back(node);
+			return id;
+		}
+
+		// Hyperplane halfway between two random nodes p and q in
+		// weighted log space e(x) = w * log(x+1)
+		const size_t stride = sig.stride();
+		const float *w = sig.weights();
+		std::uniform_int_distribution<size_t> pick(begin, end-1);
+		const float *p = sig.logs(items[pick(rng)]);
+		const float *q = sig.logs(items[pick(rng)]);
+
+		node.normal = normals.size();
+		normals.resize(normals.size() + stride);
+		for(size_t k = 0; k < stride; ++k) {
+			float ep = w[k] * p[k], eq = w[k] * q[k];
+			normals[node.normal + k] = (ep - eq) * w[k];
+			node.offset += (ep - eq) * (ep + eq) / 2.0f;
+		}
+
+		auto first = items.begin() + begin, last = items.begin() + end;
+		auto mid = std::partition(first, last, [&](size_t x) {
+			return margin(node, sig, x) < 0.0f;
+		});
+
+		// Identical nodes cannot be separated, split them at random instead
+		if(mid == first || mid == last) {
+			std::fill(normals.begin() + node.normal, normals.end(), 0.0f);
+			node.offset = 0.0f;
+			std::shuffle(first, last, rng);
+			mid = first + (end - begin) / 2;
+		}
+
+		nodes.push_back(node);
+		size_t left = build(begin, mid - items.begin(), rng);
+		size_t right = build(mid - items.begin(), end, rng);
+		nodes[id].left = left;
+		nodes[id].right = right;
+		return id;
+	}
+
+	float GDVIndex::margin(const Node &node, const PreparedSignature &q, size_t i) const {
+		const size_t stride = sig.stride();
+		const float *normal = &normals[node.normal];
+		const float *x = q.logs(i);
+		float m = 0.0f;
+		for(size_t k = 0; k < stride; ++k) {
+			m += normal[k] * x[k];
+		}
+		return m - node.offset;
+	}
+
+	void GDVIndex::query(
+		const PreparedSignature &q,
+		size_t i,
+		size_t k,
+		std::vector<Match> &out,
+		size_t search_k
+	) const {
+		if(q.orbits() != sig.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+
+		out.clear();
+		k = std::min(k, sig.size());
+		if(k == 0) return;
+		if(search_k == 0) search_k = k * roots.size();
+
+		// Best-first descent of all trees, prioritized by the smallest
+		// margin seen on the path to each node
+		std::priority_queue<std::pair<float,size_t>> queue;
+		for(size_t r : roots) {
+			queue.push(std::make_pair(std::numeric_limits<float>::infinity(), r));
+		}
+
+		// Keep descending until there are enough distinct candidates, as
+		// leaves of different trees overlap. Every tree covers all nodes,
+		// so at least k are always found.
+		const size_t want = std::max(search_k, k);
+		std::vector<size_t> candidates;
+		std::unordered_set<size_t> seen;
+		while(!queue.empty() && candidates.size() < want) {
+			std::pair<float,size_t> top = queue.top();
+			queue.pop();
+
+			const Node &node = nodes[top.second];
+			if(node.leaf) {
+				for(size_t l = node.begin; l < node.end; ++l) {
+					if(seen.insert(items[l]).second) candidates.push_back(items[l]);
+				}
+				continue;
+			}
+
+			float m = margin(node, q, i);
+			queue.push(std::make_pair(std::min(top.first, m), node.right));
+			queue.push(std::make_pair(std::min(top.first, -m), node.left));
+		}
+
+		out.reserve(candidates.size());
+		for(size_t j : candidates) {
+			Match m = { i, j, similarity(q, i, sig, j) };
+			out.push_back(m);
+		}
+
+		std::partial_sort(out.begin(), out.begin() + k, out.end(), better);
+		out.resize(k);
+	}
+
+	void GDVIndex::query(
+		const PreparedSignature &q,
+		size_t k,
+		std::vector<Match> &out,
+		size_t search_k,
+		unsigned int threads
+	) const {
+		const size_t nq = q.size();
+		k = std::min(k, sig.size());
+
+		out.resize(nq * k);
+		orca::parallel_for(0, nq, [&](size_t i) {
+			std::vector<Match> matches;
+			query(q, i, k, matches, search_k);
+			std::copy(matches.begin(), matches.end(), out.begin() + i*k);
+		}, threads);
+	}
+}
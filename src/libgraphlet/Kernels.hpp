@@ -6,36 +6,39 @@
 namespace libgraphlet {
 const char *kernel_orca_similarity_source = R"source(
 
+// Computes one na x nb tile of the similarity matrix. Dimension 0 runs
+// over j so neighbouring work items write neighbouring entries. The range
+// may be rounded up, so work items outside the tile return early.
 __kernel void orca_compute_similarity(
 	const uint na,
 	const uint nb,
-	const uint orbits,
+	const uint stride,
 	const float weights_sum,
 	__constant float *weights,
-	__global ulong *a,
-	__global ulong *b,
+	__global const float *a_log,
+	__global const float *a_inv,
+	__global const float *b_log,
+	__global const float *b_inv,
 	__global float *sim
 ) {
-	size_t global_id = get_global_id(0);
-	size_t global_size = get_global_size(0);
-
-	for(size_t i = global_id; i < na; i += global_size) {
-		for(size_t j = 0; j < nb; ++j) {
-			// Calculate distance
-			float D = 0.0f;
-			for(int k = 0; k < orbits; ++k) {
-				ulong aik = a[i*orbits + k];
-				ulong bjk = b[j*orbits + k];
-
-				float num = fabs(log(aik + 1.0f) - log(bjk + 1.0f));
-				float denom = log(max(aik, bjk) + 2.0f);
-				D += weights[k] * num / denom;
-			}
-
-			// Map distance to similarity
-			sim[i*nb + j] = 1.0f - D / weights_sum;
-		}
+	size_t j = get_global_id(0);
+	size_t i = get_global_id(1);
+	if(i >= na || j >= nb) return;
+
+	__global const float *a1 = a_log + i*stride;
+	__global const float *a2 = a_inv + i*stride;
+	__global const float *b1 = b_log + j*stride;
+	__global const float *b2 = b_inv + j*stride;
+
+	// Calculate distance from prepared log(x+1) and 1/log(x+2)
+	float D = 0.0f;
+	for(uint k = 0; k < stride; ++k) {
+		float num = fabs(a1[k] - b1[k]);
+		D += weights[k] * num * fmin(a2[k], b2[k]);
 	}
+
+	// Map distance to similarity
+	sim[i*nb + j] = 1.0f - D / weights_sum;
 }
 
 )source";
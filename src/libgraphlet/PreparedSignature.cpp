@@ -0,0 +1,89 @@
+#include <libgraphlet/PreparedSignature.hpp>
+
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	const int AFFECTED[73] = {
+		1, 2, 2, 2, 3, 4, 3, 3, 4, 3,
+		4, 4, 4, 4, 3, 4, 6, 5, 4, 5,
+		6, 6, 4, 4, 4, 5, 7, 4, 6, 6,
+		7, 4, 6, 6, 6, 5, 6, 7, 7, 5,
+		7, 6, 7, 6, 5, 5, 6, 8, 7, 6,
+		6, 8, 6, 9, 5, 6, 4, 6, 6, 7,
+		8, 6, 6, 8, 7, 6, 7, 7, 8, 5,
+		6, 6, 4
+	};
+}
+
+namespace libgraphlet {
+	const size_t PreparedSignature::LANES;
+
+	PreparedSignature::PreparedSignature(const orca::Orca &orca)
+	: n(orca.getOrbits().size1())
+	, orbit_count(orca::ORBITS[orca.graphletSize()])
+	{
+		const orca::Signature &sig = orca.getOrbits();
+		prepare(n > 0 ? &(sig.data()[0]) : nullptr, sig.size2());
+	}
+
+	PreparedSignature::PreparedSignature(const orca::GDVFile &file)
+	: n(file.size())
+	, orbit_count(file.orbits())
+	{
+		prepare(file.data(), file.stride());
+	}
+
+	PreparedSignature::PreparedSignature(
+		const int64_t *data,
+		size_t n,
+		size_t orbits,
+		size_t row_stride_in
+	)
+	: n(n)
+	, orbit_count(orbits)
+	{
+		if(orbits < 1 || orbits > 73) {
+			throw std::invalid_argument("Number of orbits must be between 1 and 73.");
+		}
+		prepare(data, row_stride_in);
+	}
+
+	void PreparedSignature::prepare(const int64_t *data, size_t row_stride_in) {
+		row_stride = (orbit_count + LANES - 1) / LANES * LANES;
+
+		std::vector<float> orbit_weights(orbit_count);
+		if(orbit_count > 1) {
+			for(size_t k = 0; k < orbit_count; ++k) {
+				orbit_weights[k] = 1.0f - log(AFFECTED[k]) / log(orbit_count);
+			}
+		} else {
+			orbit_weights[0] = 1.0f;
+		}
+
+		// store orbits by decreasing weight, orbit 0 (weight 1) first
+		order.resize(orbit_count);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) {
+			return orbit_weights[x] > orbit_weights[y];
+		});
+
+		w.assign(row_stride, 0.0f);
+		for(size_t c = 0; c < orbit_count; ++c) {
+			w[c] = orbit_weights[order[c]];
+		}
+		w_sum = std::accumulate(w.begin(), w.end(), 0.0f);
+
+		log1.assign(n * row_stride, 0.0f);
+		inv2.assign(n * row_stride, 0.0f);
+		for(size_t i = 0; i < n; ++i) {
+			const int64_t *row = data + i * row_stride_in;
+			for(size_t c = 0; c < orbit_count; ++c) {
+				double x = (double)row[order[c]];
+				log1[i*row_stride + c] = (float)std::log(x + 1.0);
+				inv2[i*row_stride + c] = (float)(1.0 / std::log(x + 2.0));
+			}
+		}
+	}
+}
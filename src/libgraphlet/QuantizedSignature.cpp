@@ -0,0 +1,36 @@
+#include <libgraphlet/QuantizedSignature.hpp>
+
+#include <cmath>
+
+namespace {
+	inline uint16_t quantize(float x, float step) {
+		float q = std::round(x / step);
+		return (uint16_t)std::min(std::max(q, 0.0f), 65535.0f);
+	}
+}
+
+namespace libgraphlet {
+	const size_t QuantizedSignature::LANES;
+	constexpr float QuantizedSignature::LOG_MAX;
+	constexpr float QuantizedSignature::INV_MAX;
+	constexpr float QuantizedSignature::LOG_STEP;
+	constexpr float QuantizedSignature::INV_STEP;
+
+	QuantizedSignature::QuantizedSignature(const PreparedSignature &sig)
+	: n(sig.size())
+	, orbit_count(sig.orbits())
+	, row_stride(sig.stride())
+	, w_sum(sig.weightsSum())
+	{
+		const float *w = sig.weights();
+		codes.resize(2 * n * row_stride);
+		for(size_t i = 0; i < n; ++i) {
+			const float *l = sig.logs(i), *v = sig.invLogs(i);
+			uint16_t *cl = &codes[2*i*row_stride], *cv = cl + row_stride;
+			for(size_t k = 0; k < row_stride; ++k) {
+				cl[k] = quantize(l[k], LOG_STEP);
+				cv[k] = quantize(w[k] * v[k], INV_STEP);
+			}
+		}
+	}
+}
@@ -1,62 +1,465 @@
 #include <libgraphlet/Similarity.hpp>
+#include <libgraphlet/QuantizedSignature.hpp>
 
 #include <numeric>
 #include <algorithm>
 #include <stdexcept>
+#include <orca/Parallel.hpp>
 
 namespace {
-	const int AFFECTED[73] = {
-		1, 2, 2, 2, 3, 4, 3, 3, 4, 3,
-		4, 4, 4, 4, 3, 4, 6, 5, 4, 5,
-		6, 6, 4, 4, 4, 5, 7, 4, 6, 6,
-		7, 4, 6, 6, 6, 5, 6, 7, 7, 5,
-		7, 6, 7, 6, 5, 5, 6, 8, 7, 6,
-		6, 8, 6, 9, 5, 6, 4, 6, 6, 7,
-		8, 6, 6, 8, 7, 6, 7, 7, 8, 5,
-		6, 6, 4
-	};
+	// Rows of A and B processed per tile. A tile of B rows stays in cache
+	// while it is compared against every row of the A tile.
+	const size_t TILE_A = 16;
+	const size_t TILE_B = 128;
+
+	// Side of the square tiles the upper triangle is mirrored in
+	const size_t TILE_MIRROR = 64;
+
+	// Orders matches from best to worst: higher score first, ties by lower j
+	inline bool better(const libgraphlet::Match &x, const libgraphlet::Match &y) {
+		if(x.score != y.score) return x.score > y.score;
+		return x.j < y.j;
+	}
+
+	// Pairs of rows begin..end of a with similarity at least cutoff. With
+	// upper set, a and b are the same network and only pairs i < j are
+	// reported.
+	void threshold(
+		const libgraphlet::PreparedSignature &a,
+		const libgraphlet::PreparedSignature &b,
+		size_t begin,
+		size_t end,
+		float cutoff,
+		std::vector<libgraphlet::Match> &out,
+		unsigned int threads,
+		bool upper
+	) {
+		const size_t nb = b.size();
+		const float bound = (1.0f - cutoff) * a.weightsSum();
+
+		out.clear();
+		if(begin == end || nb == 0 || bound < 0.0f) return;
+
+		// Nodes of b sorted by log degree. The degree term of the distance
+		// grows monotonically in both directions away from a's degree, so
+		// candidates form a window around a's position.
+		std::vector<std::pair<float,size_t>> by_degree(nb);
+		for(size_t j = 0; j < nb; ++j) {
+			by_degree[j] = std::make_pair(b.logs(j)[0], j);
+		}
+		std::sort(by_degree.begin(), by_degree.end());
+
+		const float w0 = a.weights()[0];
+		auto degree_term = [&](size_t i, size_t j) {
+			float num = std::fabs(a.logs(i)[0] - b.logs(j)[0]);
+			return w0 * num * std::min(a.invLogs(i)[0], b.invLogs(j)[0]);
+		};
+
+		const size_t tiles_a = (end - begin + TILE_A - 1) / TILE_A;
+		std::vector<std::vector<libgraphlet::Match>> found(tiles_a);
+		orca::parallel_for(0, tiles_a, [&](size_t t) {
+			size_t i0 = begin + t * TILE_A, i1 = std::min(i0 + TILE_A, end);
+			std::vector<libgraphlet::Match> &matches = found[t];
+			for(size_t i = i0; i < i1; ++i) {
+				auto visit = [&](size_t j) {
+					if(upper && j <= i) return;
+					float D = libgraphlet::distance_bounded(a, i, b, j, bound);
+					if(D <= bound) {
+						libgraphlet::Match m = { i, j, 1.0f - D / a.weightsSum() };
+						matches.push_back(m);
+					}
+				};
+
+				size_t p = std::lower_bound(
+					by_degree.begin(), by_degree.end(),
+					std::make_pair(a.logs(i)[0], (size_t)0)
+				) - by_degree.begin();
+
+				for(size_t q = p; q < nb; ++q) {
+					size_t j = by_degree[q].second;
+					if(degree_term(i, j) > bound) break;
+					visit(j);
+				}
+				for(size_t q = p; q > 0; --q) {
+					size_t j = by_degree[q-1].second;
+					if(degree_term(i, j) > bound) break;
+					visit(j);
+				}
+			}
+		}, threads, 1);
+
+		size_t total = 0;
+		for(auto &v : found) total += v.size();
+		out.reserve(total);
+		for(auto &v : found) {
+			out.insert(out.end(), v.begin(), v.end());
+		}
+	}
+
+	// Computes rows begin..end of the similarity matrix into out, which
+	// holds (end - begin) rows of nb values. With upper set, only entries
+	// j >= i are written.
+	template<typename S>
+	void rows(
+		const S &a,
+		const S &b,
+		size_t begin,
+		size_t end,
+		float *out,
+		unsigned int threads,
+		bool upper = false
+	) {
+		const size_t nb = b.size();
+		const size_t tiles_a = (end - begin + TILE_A - 1) / TILE_A;
+		orca::parallel_for(0, tiles_a, [&](size_t t) {
+			size_t i0 = begin + t * TILE_A, i1 = std::min(i0 + TILE_A, end);
+			for(size_t j0 = upper ? i0 : 0; j0 < nb; j0 += TILE_B) {
+				size_t j1 = std::min(j0 + TILE_B, nb);
+				for(size_t i = i0; i < i1; ++i) {
+					float *row = out + (i - begin)*nb;
+					for(size_t j = upper ? std::max(j0, i) : j0; j < j1; ++j) {
+						row[j] = libgraphlet::similarity(a, i, b, j);
+					}
+				}
+			}
+		}, threads, 1);
+	}
+
+	// Fills the na x nb matrix sim. If a and b are the same object,
+	// computes the upper triangle and mirrors it.
+	template<typename S>
+	void matrix(
+		const S &a,
+		const S &b,
+		boost::numeric::ublas::matrix<float> &sim,
+		unsigned int threads
+	) {
+		const size_t na = a.size();
+		const size_t nb = b.size();
+
+		sim.resize(na, nb, false);
+		if(na == 0 || nb == 0) return;
+		float *out = &(sim.data()[0]);
+
+		// Same network: compute the upper triangle and mirror it
+		const bool self = (&a == &b);
+		rows(a, b, 0, na, out, threads, self);
+
+		if(self) {
+			// Blocked transpose into the lower triangle. Each task fills
+			// one band of rows from a column band of the upper triangle,
+			// one tile at a time so both stay in cache.
+			const size_t bands = (na + TILE_MIRROR - 1) / TILE_MIRROR;
+			orca::parallel_for(0, bands, [&](size_t bi) {
+				size_t i0 = bi * TILE_MIRROR, i1 = std::min(i0 + TILE_MIRROR, na);
+				for(size_t j0 = 0; j0 < i1; j0 += TILE_MIRROR) {
+					size_t j1 = std::min(j0 + TILE_MIRROR, i1);
+					for(size_t i = i0; i < i1; ++i) {
+						for(size_t j = j0; j < std::min(j1, i); ++j) {
+							out[i*nb + j] = out[j*nb + i];
+						}
+					}
+				}
+			}, threads, 1);
+		}
+	}
+
+	// Keeps the k best matches of rows begin..end of a. Each row owns a
+	// fixed slice of out, used as a heap with the worst kept match on top.
+	template<typename S>
+	void topk(
+		const S &a,
+		const S &b,
+		size_t begin,
+		size_t end,
+		size_t k,
+		std::vector<libgraphlet::Match> &out,
+		unsigned int threads
+	) {
+		const size_t nb = b.size();
+		k = std::min(k, nb);
+
+		out.resize((end - begin) * k);
+		if(k == 0) return;
+
+		const size_t tiles_a = (end - begin + TILE_A - 1) / TILE_A;
+		orca::parallel_for(0, tiles_a, [&](size_t t) {
+			size_t i0 = begin + t * TILE_A, i1 = std::min(i0 + TILE_A, end);
+			std::vector<size_t> count(i1 - i0, 0);
+			for(size_t j0 = 0; j0 < nb; j0 += TILE_B) {
+				size_t j1 = std::min(j0 + TILE_B, nb);
+				for(size_t i = i0; i < i1; ++i) {
+					libgraphlet::Match *heap = &out[(i-begin)*k];
+					size_t &c = count[i-i0];
+					for(size_t j = j0; j < j1; ++j) {
+						libgraphlet::Match m = { i, j, libgraphlet::similarity(a, i, b, j) };
+						if(c < k) {
+							heap[c++] = m;
+							std::push_heap(heap, heap + c, better);
+						} else if(better(m, heap[0])) {
+							std::pop_heap(heap, heap + k, better);
+							heap[k-1] = m;
+							std::push_heap(heap, heap + k, better);
+						}
+					}
+				}
+			}
+			for(size_t i = i0; i < i1; ++i) {
+				std::sort_heap(&out[(i-begin)*k], &out[(i-begin)*k] + k, better);
+			}
+		}, threads, 1);
+	}
+
+	// Scores pairs in place, visiting them in (i, j) order
+	template<typename S>
+	void pairs_kernel(
+		const S &a,
+		const S &b,
+		std::vector<libgraphlet::Match> &pairs,
+		unsigned int threads
+	) {
+		for(const libgraphlet::Match &m : pairs) {
+			if(m.i >= a.size() || m.j >= b.size()) {
+				throw std::invalid_argument("Pair index out of range.");
+			}
+		}
+
+		std::vector<size_t> order(pairs.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](size_t x, size_t y) {
+			if(pairs[x].i != pairs[y].i) return pairs[x].i < pairs[y].i;
+			return pairs[x].j < pairs[y].j;
+		});
+
+		const size_t BATCH = TILE_A * TILE_B;
+		const size_t batches = (order.size() + BATCH - 1) / BATCH;
+		orca::parallel_for(0, batches, [&](size_t t) {
+			size_t p0 = t * BATCH, p1 = std::min(p0 + BATCH, order.size());
+			for(size_t p = p0; p < p1; ++p) {
+				libgraphlet::Match &m = pairs[order[p]];
+				m.score = libgraphlet::similarity(a, m.i, b, m.j);
+			}
+		}, threads, 1);
+	}
 }
 
 namespace libgraphlet {
 	void similarity(
 		const orca::Orca &oa,
 		const orca::Orca &ob,
-		boost::numeric::ublas::matrix<float> &sim
+		boost::numeric::ublas::matrix<float> &sim,
+		unsigned int threads
 	) {
 		if(oa.graphletSize() != ob.graphletSize()) {
 			throw std::invalid_argument("Orca instances now of same size");
 		}
-		int graphlet_size = oa.graphletSize();
-		const size_t orbits = orca::ORBITS[graphlet_size];
-		const size_t na = oa.getOrbits().size1();
-		const size_t nb = ob.getOrbits().size1();
 
-		std::vector<float> weights(orbits);
-		if(orbits > 1) {
-			for(size_t k = 0; k < orbits; ++k) {
-				weights[k] = 1.0f - log(AFFECTED[k]) / log(orbits);
-			}
-		} else {
-			weights[0] = 1.0f;
+		PreparedSignature a(oa);
+		if(&oa == &ob) {
+			similarity(a, a, sim, threads);
+			return;
 		}
-		float weights_sum = std::accumulate(weights.begin(), weights.end(), 0.0f);
+		PreparedSignature b(ob);
+		similarity(a, b, sim, threads);
+	}
 
-		sim.resize(na, nb);
+	void similarity(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		boost::numeric::ublas::matrix<float> &sim,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		matrix(a, b, sim, threads);
+	}
 
-		for(size_t i = 0; i < na; ++i) {
-			for(size_t j = 0; j < nb; ++j) {
-				float D = 0.0f;
-				for(size_t k = 0; k < orbits; ++k) {
-					int64_t aik = oa.getOrbits()(i, k);
-					int64_t bjk = ob.getOrbits()(j, k);
+	void similarity_topk(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		size_t k,
+		std::vector<Match> &out,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		topk(a, b, 0, a.size(), k, out, threads);
+	}
 
-					float num = fabs(log(aik + 1.0f) - log(bjk + 1.0f));
-					float denom = log(std::max(aik, bjk) + 2.0f);
-					D += weights[k] * num / denom;
-				}
+	void similarity_threshold(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		float cutoff,
+		std::vector<Match> &out,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		threshold(a, b, 0, a.size(), cutoff, out, threads, false);
+	}
+
+	void similarity_threshold(
+		const PreparedSignature &a,
+		float cutoff,
+		std::vector<Match> &out,
+		unsigned int threads
+	) {
+		threshold(a, a, 0, a.size(), cutoff, out, threads, true);
+	}
 
-				sim(i, j) = 1.0f - D / weights_sum;
+	void similarity_pairs(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		std::vector<Match> &pairs,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		pairs_kernel(a, b, pairs, threads);
+	}
+
+	void similarity(
+		const orca::Orca &o,
+		std::vector<float> &sim,
+		unsigned int threads
+	) {
+		PreparedSignature a(o);
+		similarity(a, sim, threads);
+	}
+
+	void similarity(
+		const PreparedSignature &a,
+		std::vector<float> &sim,
+		unsigned int threads
+	) {
+		const size_t n = a.size();
+		sim.resize(n > 0 ? n*(n-1)/2 : 0);
+		if(sim.empty()) return;
+
+		// Tiles near the bottom hold short rows, so they are handed out
+		// one at a time for balance
+		const size_t tiles = (n + TILE_A - 1) / TILE_A;
+		orca::parallel_for(0, tiles, [&](size_t t) {
+			size_t i0 = t * TILE_A, i1 = std::min(i0 + TILE_A, n);
+			for(size_t j0 = i0 + 1; j0 < n; j0 += TILE_B) {
+				size_t j1 = std::min(j0 + TILE_B, n);
+				for(size_t i = i0; i < i1; ++i) {
+					for(size_t j = std::max(j0, i+1); j < j1; ++j) {
+						sim[triangle_index(n, i, j)] = similarity(a, i, a, j);
+					}
+				}
 			}
+		}, threads, 1);
+	}
+
+	void similarity(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		boost::numeric::ublas::matrix<float> &sim,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		matrix(a, b, sim, threads);
+	}
+
+	void similarity_topk(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		size_t k,
+		std::vector<Match> &out,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		topk(a, b, 0, a.size(), k, out, threads);
+	}
+
+	void similarity_pairs(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		std::vector<Match> &pairs,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		pairs_kernel(a, b, pairs, threads);
+	}
+
+	void similarity_rows(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		size_t begin,
+		size_t end,
+		float *out,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		if(begin > end || end > a.size()) {
+			throw std::invalid_argument("Row range out of bounds.");
+		}
+		rows(a, b, begin, end, out, threads);
+	}
+
+	void similarity_rows(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		size_t begin,
+		size_t end,
+		float *out,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		if(begin > end || end > a.size()) {
+			throw std::invalid_argument("Row range out of bounds.");
+		}
+		rows(a, b, begin, end, out, threads);
+	}
+
+	void similarity_topk_rows(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		size_t begin,
+		size_t end,
+		size_t k,
+		std::vector<Match> &out,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		if(begin > end || end > a.size()) {
+			throw std::invalid_argument("Row range out of bounds.");
+		}
+		topk(a, b, begin, end, k, out, threads);
+	}
+
+	void similarity_threshold_rows(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		size_t begin,
+		size_t end,
+		float cutoff,
+		std::vector<Match> &out,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		if(begin > end || end > a.size()) {
+			throw std::invalid_argument("Row range out of bounds.");
 		}
+		threshold(a, b, begin, end, cutoff, out, threads, false);
 	}
 }
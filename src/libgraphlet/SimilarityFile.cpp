@@ -0,0 +1,152 @@
+#include <libgraphlet/SimilarityFile.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgraphlet/Similarity.hpp>
+
+namespace {
+	const char MAGIC[8] = { 'L', 'G', 'S', 'I', 'M', 'M', 'A', 'T' };
+	const uint32_t VERSION = 1;
+
+	static_assert(sizeof(libgraphlet::SimilarityFileHeader) == 64, "Header must be 64 bytes");
+
+	template<typename S>
+	void write_blocks(
+		const S &a,
+		const S &b,
+		const std::string &path,
+		size_t block_rows,
+		unsigned int threads
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		const size_t na = a.size();
+		const size_t nb = b.size();
+		if(block_rows == 0) block_rows = 1;
+
+		FILE *file = fopen(path.c_str(), "wb");
+		if(!file) {
+			throw std::runtime_error("Could not open " + path + " for writing.");
+		}
+
+		libgraphlet::SimilarityFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.header_size = sizeof(header);
+		header.rows = na;
+		header.cols = nb;
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+		// Double buffering: block k is computed while block k-1 is written
+		std::vector<float> buffers[2];
+		buffers[0].resize(std::min(block_rows, na) * nb);
+		buffers[1].resize(std::min(block_rows, na) * nb);
+
+		std::thread writer;
+		bool write_ok = true;
+		try {
+			for(size_t k = 0, i0 = 0; i0 < na && ok; ++k, i0 += block_rows) {
+				size_t i1 = std::min(i0 + block_rows, na);
+				std::vector<float> &buf = buffers[k % 2];
+				libgraphlet::similarity_rows(a, b, i0, i1, buf.data(), threads);
+
+				if(writer.joinable()) writer.join();
+				ok = write_ok;
+
+				size_t count = (i1 - i0) * nb;
+				writer = std::thread([&buf, count, file, &write_ok]() {
+					write_ok = fwrite(buf.data(), sizeof(float), count, file) == count;
+				});
+			}
+		} catch(...) {
+			if(writer.joinable()) writer.join();
+			fclose(file);
+			throw;
+		}
+		if(writer.joinable()) writer.join();
+		ok = ok && write_ok;
+
+		if(fclose(file) != 0 || !ok) {
+			throw std::runtime_error("Error writing " + path + ".");
+		}
+	}
+}
+
+namespace libgraphlet {
+	void similarity_file(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		const std::string &path,
+		size_t block_rows,
+		unsigned int threads
+	) {
+		write_blocks(a, b, path, block_rows, threads);
+	}
+
+	void similarity_file(
+		const QuantizedSignature &a,
+		const QuantizedSignature &b,
+		const std::string &path,
+		size_t block_rows,
+		unsigned int threads
+	) {
+		write_blocks(a, b, path, block_rows, threads);
+	}
+
+	SimilarityFile::SimilarityFile(const std::string &path)
+	: map(nullptr)
+	, map_size(0)
+	, n_rows(0)
+	, n_cols(0)
+	, data(nullptr)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if(fd < 0) {
+			throw std::runtime_error("Could not open " + path + ".");
+		}
+
+		struct stat st;
+		if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SimilarityFileHeader)) {
+			close(fd);
+			throw std::runtime_error(path + " is not a similarity matrix file.");
+		}
+		map_size = st.st_size;
+
+		map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if(map == MAP_FAILED) {
+			map = nullptr;
+			throw std::runtime_error("Could not map " + path + ".");
+		}
+
+		const SimilarityFileHeader *header = (const SimilarityFileHeader*)map;
+		bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0
+			&& header->version == VERSION
+			&& header->header_size >= sizeof(SimilarityFileHeader)
+			&& header->header_size <= map_size
+			&& header->header_size % sizeof(float) == 0
+			&& (map_size - header->header_size) / sizeof(float) / std::max<uint64_t>(header->cols, 1) >= header->rows;
+		if(!valid) {
+			munmap(map, map_size);
+			map = nullptr;
+			throw std::runtime_error(path + " is not a valid similarity matrix file.");
+		}
+
+		n_rows = header->rows;
+		n_cols = header->cols;
+		data = (const float*)((const char*)map + header->header_size);
+	}
+
+	SimilarityFile::~SimilarityFile() {
+		if(map) munmap(map, map_size);
+	}
+}
@@ -1,55 +1,35 @@
 #include <libgraphlet/SimilarityGPU.hpp>
 
 #include <iostream>
+#include <cstring>
 #include <algorithm>
 #include <stdexcept>
-#include <boost/compute/container/vector.hpp>
 #include "Kernels.hpp"
 
 namespace compute = boost::compute;
 
 namespace {
-	const int AFFECTED[73] = {
-		1, 2, 2, 2, 3, 4, 3, 3, 4, 3,
-		4, 4, 4, 4, 3, 4, 6, 5, 4, 5,
-		6, 6, 4, 4, 4, 5, 7, 4, 6, 6,
-		7, 4, 6, 6, 6, 5, 6, 7, 7, 5,
-		7, 6, 7, 6, 5, 5, 6, 8, 7, 6,
-		6, 8, 6, 9, 5, 6, 4, 6, 6, 7,
-		8, 6, 6, 8, 7, 6, 7, 7, 8, 5,
-		6, 6, 4
-	};
+	// Work items per dimension the launch range is rounded up to
+	const size_t GROUP = 16;
+
+	inline size_t round_up(size_t x, size_t m) {
+		return (x + m - 1) / m * m;
+	}
 }
 
 namespace libgraphlet {
-	void similarityGPU(
-		const orca::Orca &oa,
-		const orca::Orca &ob,
-		boost::numeric::ublas::matrix<float> &sim,
-		const compute::device &device
-	) {
-		if(oa.graphletSize() != ob.graphletSize()) {
-			throw std::invalid_argument("Orca instances not of same size.");
-		}
-		int graphlet_size = oa.graphletSize();
-		const size_t orbits = orca::ORBITS[graphlet_size];
-		const size_t na = oa.getOrbits().size1();
-		const size_t nb = ob.getOrbits().size1();
-
-		std::vector<float> weights(orbits);
-		if(orbits > 1) {
-			for(size_t k = 0; k < orbits; ++k) {
-				weights[k] = 1.0f - log(AFFECTED[k]) / log(orbits);
-			}
-		} else {
-			weights[0] = 1.0f;
-		}
-		float weights_sum = std::accumulate(weights.begin(), weights.end(), 0.0f);
-
-		compute::context context(device);
-		compute::command_queue queue(context, device);
-
-		compute::program program = compute::program::create_with_source(
+	SimilarityEngine::SimilarityEngine(
+		const compute::device &device,
+		size_t tile_rows,
+		size_t tile_cols
+	)
+	: dev(device)
+	, context(device)
+	, tile_rows(std::max<size_t>(tile_rows, 1))
+	, tile_cols(std::max<size_t>(tile_cols, 1))
+	, buffer_stride(0)
+	{
+		program = compute::program::create_with_source(
 			kernel_orca_similarity_source,
 			context
 		);
@@ -61,54 +41,164 @@ namespace libgraphlet {
 			throw;
 		}
 
-		compute::kernel kernel = program.create_kernel("orca_compute_similarity");
-
-		compute::vector<cl_uint> buf_weights(orbits, context);
-		compute::vector<cl_ulong> buf_a(na * orbits, context);
-		compute::vector<cl_ulong> buf_b(nb * orbits, context);
-		compute::vector<cl_float> buf_sim(na * nb, context);
-
-		int arg = 0;
-		kernel.set_arg(arg++, (cl_uint)na);
-		kernel.set_arg(arg++, (cl_uint)nb);
-		kernel.set_arg(arg++, (cl_uint)orbits);
-		kernel.set_arg(arg++, (cl_float)weights_sum);
-		kernel.set_arg(arg++, buf_weights);
-		kernel.set_arg(arg++, buf_a);
-		kernel.set_arg(arg++, buf_b);
-		kernel.set_arg(arg++, buf_sim);
-
-		compute::copy(
-			weights.begin(),
-			weights.end(),
-			buf_weights.begin(),
-			queue
-		);
+		// Shrink tiles until the largest buffer can be allocated and both
+		// slots plus the tile of b use at most 3/4 of device memory.
+		// The larger dimension is halved first to keep tiles square-ish.
+		const size_t L = PreparedSignature::LANES;
+		const size_t max_stride = (orca::ORBITS[5] + L - 1) / L * L;
+		auto fits = [&]() {
+			size_t sim_bytes = this->tile_rows * this->tile_cols * sizeof(float);
+			size_t a_bytes = 2 * this->tile_rows * max_stride * sizeof(float);
+			size_t b_bytes = 2 * this->tile_cols * max_stride * sizeof(float);
+			return sim_bytes <= dev.max_memory_alloc_size()
+				&& 2 * (sim_bytes + a_bytes) + b_bytes <= dev.global_memory_size() / 4 * 3;
+		};
+		while(!fits() && (this->tile_rows > 1 || this->tile_cols > 1)) {
+			if(this->tile_rows >= this->tile_cols) this->tile_rows /= 2;
+			else this->tile_cols /= 2;
+		}
 
-		compute::copy_n(
-			&(oa.getOrbits().data()[0]),
-			na*orbits,
-			buf_a.begin(),
-			queue
-		);
+		for(Slot &slot : slots) {
+			slot.queue = compute::command_queue(context, dev);
+			slot.kernel = program.create_kernel("orca_compute_similarity");
+			slot.host.resize(this->tile_rows * this->tile_cols);
+			slot.pending = false;
+		}
+	}
 
-		compute::copy_n(
-			&(ob.getOrbits().data()[0]),
-			nb*orbits,
-			buf_b.begin(),
-			queue
-		);
+	void SimilarityEngine::reserve(size_t stride) {
+		if(stride == buffer_stride) return;
+
+		weights = compute::buffer(context, stride * sizeof(float), compute::buffer::read_only);
+		b_log = compute::buffer(context, tile_cols * stride * sizeof(float), compute::buffer::read_only);
+		b_inv = compute::buffer(context, tile_cols * stride * sizeof(float), compute::buffer::read_only);
+		for(Slot &slot : slots) {
+			slot.a_log = compute::buffer(context, tile_rows * stride * sizeof(float), compute::buffer::read_only);
+			slot.a_inv = compute::buffer(context, tile_rows * stride * sizeof(float), compute::buffer::read_only);
+			slot.sim = compute::buffer(context, tile_rows * tile_cols * sizeof(float), compute::buffer::write_only);
+		}
+		buffer_stride = stride;
+	}
 
-		queue.enqueue_1d_range_kernel(kernel, 0, 1024, 0);
+	void SimilarityEngine::finish(Slot &slot, float *out, size_t nb) {
+		slot.done.wait();
+		const size_t tb = slot.j1 - slot.j0;
+		for(size_t i = slot.i0; i < slot.i1; ++i) {
+			memcpy(out + i*nb + slot.j0, &slot.host[(i - slot.i0)*tb], tb * sizeof(float));
+		}
+		slot.pending = false;
+	}
 
-		queue.finish();
+	void SimilarityEngine::similarity(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		boost::numeric::ublas::matrix<float> &sim
+	) {
+		sim.resize(a.size(), b.size(), false);
+		if(a.size() == 0 || b.size() == 0) return;
+		similarity(a, b, &(sim.data()[0]));
+	}
 
-		sim.resize(na, nb);
-		compute::copy(
-			buf_sim.begin(),
-			buf_sim.end(),
-			&(sim.data()[0]),
-			queue
-		);
+	void SimilarityEngine::similarity(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		float *out
+	) {
+		if(a.orbits() != b.orbits()) {
+			throw std::invalid_argument("Signatures do not have the same number of orbits.");
+		}
+		const size_t na = a.size();
+		const size_t nb = b.size();
+		const size_t stride = a.stride();
+		if(na == 0 || nb == 0) return;
+
+		// Asynchronous reads target the slots' host buffers, so pending
+		// commands must complete before an error propagates
+		try {
+			reserve(stride);
+			slots[0].queue.enqueue_write_buffer(weights, 0, stride * sizeof(float), a.weights());
+
+			for(size_t j0 = 0; j0 < nb; j0 += tile_cols) {
+				size_t j1 = std::min(j0 + tile_cols, nb);
+				const size_t tb = j1 - j0;
+
+				// Both slots read the tile of b, so drain them before replacing it
+				for(Slot &slot : slots) {
+					if(slot.pending) finish(slot, out, nb);
+				}
+				slots[0].queue.enqueue_write_buffer(b_log, 0, tb * stride * sizeof(float), b.logs(j0));
+				slots[0].queue.enqueue_write_buffer(b_inv, 0, tb * stride * sizeof(float), b.invLogs(j0));
+
+				size_t k = 0;
+				for(size_t i0 = 0; i0 < na; i0 += tile_rows, ++k) {
+					size_t i1 = std::min(i0 + tile_rows, na);
+					const size_t ta = i1 - i0;
+
+					Slot &slot = slots[k % 2];
+					if(slot.pending) finish(slot, out, nb);
+
+					slot.queue.enqueue_write_buffer_async(slot.a_log, 0, ta * stride * sizeof(float), a.logs(i0));
+					slot.queue.enqueue_write_buffer_async(slot.a_inv, 0, ta * stride * sizeof(float), a.invLogs(i0));
+
+					int arg = 0;
+					slot.kernel.set_arg(arg++, (cl_uint)ta);
+					slot.kernel.set_arg(arg++, (cl_uint)tb);
+					slot.kernel.set_arg(arg++, (cl_uint)stride);
+					slot.kernel.set_arg(arg++, (cl_float)a.weightsSum());
+					slot.kernel.set_arg(arg++, weights);
+					slot.kernel.set_arg(arg++, slot.a_log);
+					slot.kernel.set_arg(arg++, slot.a_inv);
+					slot.kernel.set_arg(arg++, b_log);
+					slot.kernel.set_arg(arg++, b_inv);
+					slot.kernel.set_arg(arg++, slot.sim);
+
+					size_t global[2] = { round_up(tb, GROUP), round_up(ta, GROUP) };
+					slot.queue.enqueue_nd_range_kernel(slot.kernel, 2, 0, global, 0);
+					slot.done = slot.queue.enqueue_read_buffer_async(slot.sim, 0, ta * tb * sizeof(float), slot.host.data());
+					slot.queue.flush();
+
+					slot.i0 = i0;
+					slot.i1 = i1;
+					slot.j0 = j0;
+					slot.j1 = j1;
+					slot.pending = true;
+				}
+			}
+
+			for(Slot &slot : slots) {
+				if(slot.pending) finish(slot, out, nb);
+			}
+		} catch(...) {
+			for(Slot &slot : slots) {
+				slot.queue.finish();
+				slot.pending = false;
+			}
+			throw;
+		}
+	}
+
+	void similarityGPU(
+		const orca::Orca &oa,
+		const orca::Orca &ob,
+		boost::numeric::ublas::matrix<float> &sim,
+		const compute::device &device
+	) {
+		if(oa.graphletSize() != ob.graphletSize()) {
+			throw std::invalid_argument("Orca instances not of same size.");
+		}
+
+		PreparedSignature a(oa);
+		PreparedSignature b(ob);
+		similarityGPU(a, b, sim, device);
+	}
+
+	void similarityGPU(
+		const PreparedSignature &a,
+		const PreparedSignature &b,
+		boost::numeric::ublas::matrix<float> &sim,
+		const compute::device &device
+	) {
+		SimilarityEngine engine(device);
+		engine.similarity(a, b, sim);
 	}
 }
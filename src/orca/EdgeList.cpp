@@ -0,0 +1,257 @@
+#include <orca/EdgeList.hpp>
+
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <orca/Parallel.hpp>
+
+namespace {
+	// Parts are at least this many bytes, so small files use one thread
+	const size_t MIN_PART = 1 << 20;
+
+	// Label pointing into the input buffer
+	struct Token {
+		const char *data;
+		size_t size;
+	};
+
+	inline uint64_t hash_token(const Token &t) {
+		// FNV-1a with a final mix, as the table uses the low bits
+		uint64_t h = 14695981039346656037ULL;
+		for(size_t i = 0; i < t.size; ++i) {
+			h = (h ^ (unsigned char)t.data[i]) * 1099511628211ULL;
+		}
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	/**
+	 * Open addressing table numbering distinct tokens in order of
+	 * insertion. Tokens are not copied and must outlive the table.
+	 */
+	class Interner {
+		public:
+			Interner() : mask(1023), slots(mask + 1) { }
+
+			/**
+			 * Returns the number of t, adding it to tokens if new.
+			 */
+			size_t intern(const Token &t) {
+				if(2 * (tokens.size() + 1) > slots.size()) grow();
+				uint64_t h = hash_token(t);
+				for(size_t i = h & mask; ; i = (i + 1) & mask) {
+					Slot &s = slots[i];
+					if(s.id == EMPTY) {
+						s.hash = h;
+						s.token = t;
+						s.id = tokens.size();
+						tokens.push_back(t);
+						return s.id;
+					}
+					if(s.hash == h && s.token.size == t.size && memcmp(s.token.data, t.data, t.size) == 0) {
+						return s.id;
+					}
+				}
+			}
+
+			std::vector<Token> tokens;
+
+		private:
+			static const size_t EMPTY = (size_t)-1;
+
+			struct Slot {
+				uint64_t hash;
+				Token token;
+				size_t id;
+				Slot() : hash(0), token(), id(EMPTY) { }
+			};
+
+			void grow() {
+				mask = 2 * mask + 1;
+				std::vector<Slot> old(mask + 1);
+				old.swap(slots);
+				for(const Slot &s : old) {
+					if(s.id == EMPTY) continue;
+					size_t i = s.hash & mask;
+					while(slots[i].id != EMPTY) i = (i + 1) & mask;
+					slots[i] = s;
+				}
+			}
+
+			size_t mask;
+			std::vector<Slot> slots;
+	};
+
+	inline bool is_blank(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	// Labels and edges of one part, numbered locally in order of appearance
+	struct Part {
+		const char *begin, *end;
+		Interner labels;
+		std::vector<std::pair<size_t,size_t>> edges;
+	};
+
+	void parse_part(Part &part) {
+		const char *p = part.begin;
+		while(p < part.end) {
+			const char *eol = (const char*)memchr(p, '\n', part.end - p);
+			if(!eol) eol = part.end;
+
+			while(p < eol && is_blank(*p)) ++p;
+			if(p < eol && *p != '#') {
+				Token a = { p, 0 };
+				while(p < eol && !is_blank(*p)) ++p;
+				a.size = p - a.data;
+
+				while(p < eol && is_blank(*p)) ++p;
+				if(p == eol) {
+					throw std::invalid_argument("Edge list line has fewer than two columns: " + std::string(a.data, a.size));
+				}
+				Token b = { p, 0 };
+				while(p < eol && !is_blank(*p)) ++p;
+				b.size = p - b.data;
+
+				size_t u = part.labels.intern(a);
+				size_t v = part.labels.intern(b);
+				part.edges.push_back(std::make_pair(u, v));
+			}
+			p = eol + 1;
+		}
+	}
+}
+
+namespace orca {
+	void parse_edge_list(
+		const char *data,
+		size_t size,
+		EdgeList &out,
+		unsigned int threads
+	) {
+		out.labels.clear();
+		out.edges.clear();
+		if(size == 0) return;
+
+		if(threads == 0) threads = default_threads();
+		const size_t count = std::max<size_t>(1, std::min<size_t>(4 * threads, size / MIN_PART));
+
+		// Split at line boundaries
+		std::vector<Part> parts;
+		const char *end = data + size;
+		const char *p = data;
+		for(size_t i = 1; i <= count && p < end; ++i) {
+			const char *q = (i == count ? end : std::max(p, data + size * i / count));
+			if(q < end) {
+				const char *eol = (const char*)memchr(q, '\n', end - q);
+				q = eol ? eol + 1 : end;
+			}
+			Part part;
+			part.begin = p;
+			part.end = q;
+			parts.push_back(std::move(part));
+			p = q;
+		}
+
+		parallel_for(0, parts.size(), [&](size_t i) {
+			parse_part(parts[i]);
+		}, threads, 1);
+
+		// Number labels globally in order of first appearance
+		std::vector<std::vector<size_t>> ids(parts.size());
+		Interner global;
+		for(size_t i = 0; i < parts.size(); ++i) {
+			const std::vector<Token> &tokens = parts[i].labels.tokens;
+			ids[i].resize(tokens.size());
+			for(size_t j = 0; j < tokens.size(); ++j) {
+				ids[i][j] = global.intern(tokens[j]);
+			}
+			parts[i].labels = Interner();
+		}
+		out.labels.reserve(global.tokens.size());
+		for(const Token &t : global.tokens) {
+			out.labels.push_back(std::string(t.data, t.size));
+		}
+
+		// Renumber, orient and deduplicate every part
+		parallel_for(0, parts.size(), [&](size_t i) {
+			auto &edges = parts[i].edges;
+			size_t k = 0;
+			for(auto &e : edges) {
+				size_t u = ids[i][e.first], v = ids[i][e.second];
+				if(u == v) continue;
+				edges[k++] = std::make_pair(std::min(u, v), std::max(u, v));
+			}
+			edges.resize(k);
+			std::sort(edges.begin(), edges.end());
+			edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+		}, threads, 1);
+
+		// Concatenate the sorted runs and merge them pairwise
+		std::vector<size_t> offsets(1, 0);
+		for(auto &part : parts) offsets.push_back(offsets.back() + part.edges.size());
+		out.edges.resize(offsets.back());
+		parallel_for(0, parts.size(), [&](size_t i) {
+			std::copy(parts[i].edges.begin(), parts[i].edges.end(), out.edges.begin() + offsets[i]);
+			std::vector<std::pair<size_t,size_t>>().swap(parts[i].edges);
+		}, threads, 1);
+
+		while(offsets.size() > 2) {
+			const size_t runs = offsets.size() - 1;
+			parallel_for(0, runs / 2, [&](size_t r) {
+				auto begin = out.edges.begin();
+				std::inplace_merge(begin + offsets[2*r], begin + offsets[2*r+1], begin + offsets[2*r+2]);
+			}, threads, 1);
+
+			std::vector<size_t> next;
+			for(size_t r = 0; r < offsets.size(); r += 2) next.push_back(offsets[r]);
+			if(next.back() != offsets.back()) next.push_back(offsets.back());
+			offsets.swap(next);
+		}
+		out.edges.erase(std::unique(out.edges.begin(), out.edges.end()), out.edges.end());
+	}
+
+	void read_edge_list(
+		const std::string &path,
+		EdgeList &out,
+		unsigned int threads
+	) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if(fd < 0) {
+			throw std::runtime_error("Could not open " + path + ".");
+		}
+		struct stat st;
+		if(fstat(fd, &st) != 0) {
+			close(fd);
+			throw std::runtime_error("Could not read " + path + ".");
+		}
+		const size_t size = st.st_size;
+		if(size == 0) {
+			close(fd);
+			parse_edge_list(nullptr, 0, out, threads);
+			return;
+		}
+
+		void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(map == MAP_FAILED) {
+			throw std::runtime_error("Could not map " + path + ".");
+		}
+		madvise(map, size, MADV_SEQUENTIAL);
+
+		try {
+			parse_edge_list((const char*)map, size, out, threads);
+		} catch(...) {
+			munmap(map, size);
+			throw;
+		}
+		munmap(map, size);
+	}
+}
@@ -0,0 +1,203 @@
+#include <orca/Estimate.hpp>
+#include <orca/Orca.hpp>
+#include <orca/Parallel.hpp>
+
+#include <cmath>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	// Approximate footprint of one unordered_map entry in common2/common3:
+	// node (next pointer, key, value, cached hash), allocator overhead
+	// and one bucket pointer at load factor 1.
+	const size_t COMMON2_ENTRY_BYTES = 56;
+	const size_t COMMON3_ENTRY_BYTES = 56;
+
+	// One cached two-hop count: the node and its number of paths
+	const size_t TWO_HOP_ENTRY_BYTES = sizeof(std::pair<int,int>);
+
+	double choose2(double d) { return d * (d - 1.0) / 2.0; }
+	double choose3(double d) { return d * (d - 1.0) * (d - 2.0) / 6.0; }
+}
+
+namespace orca {
+	CostEstimate estimate(
+		const CSR &graph,
+		unsigned int graphlet_size,
+		size_t samples,
+		double ns_per_step,
+		unsigned int threads,
+		size_t memory_budget,
+		size_t cache_budget
+	) {
+		if(graphlet_size < 2 || graphlet_size > 5) {
+			throw std::invalid_argument("Only graphlets of size 2-5 supported.");
+		}
+
+		const size_t n = graph.nodes();
+		const size_t m = graph.edges();
+
+		CostEstimate est;
+		est.nodes = n;
+		est.edges = m;
+
+		// Degree moments, sum over edges of deg(a)*deg(b) and of min(deg(a),deg(b))
+		double D2 = 0.0, D3 = 0.0, C3 = 0.0, S = 0.0, M = 0.0, wedges = 0.0;
+		std::vector<double> weights(n);
+		for(size_t x = 0; x < n; ++x) {
+			double d = graph[x].size();
+			D2 += d * d;
+			D3 += d * d * d;
+			C3 += choose3(d);
+			weights[x] = choose2(d);
+			wedges += weights[x];
+			for(int y : graph[x]) {
+				S += d * graph[y].size();
+				if(y > (int)x) M += std::min(d, (double)graph[y].size());
+			}
+		}
+		est.wedges = wedges;
+
+		// Estimate triangles by sampling wedges and checking for closure
+		double transitivity = 0.0;
+		if(wedges > 0.0 && samples > 0) {
+			std::mt19937_64 rng(1);
+			std::discrete_distribution<size_t> center(weights.begin(), weights.end());
+			size_t closed = 0;
+			for(size_t i = 0; i < samples; ++i) {
+				Row<int> row = graph[center(rng)];
+				std::uniform_int_distribution<size_t> pick(0, row.size()-1);
+				size_t u = pick(rng), v = pick(rng);
+				while(v == u) v = pick(rng);
+				Row<int> ru = graph[row[u]];
+				if(std::binary_search(ru.begin(), ru.end(), row[v])) closed++;
+			}
+			transitivity = (double)closed / samples;
+		}
+		est.triangles = transitivity * wedges / 3.0;
+
+		// Expected triangles on an edge, and wedges of triangles around a node
+		double tri_pairs = 0.0;
+		for(size_t x = 0; x < n; ++x) {
+			for(int y : graph[x]) {
+				double t = transitivity * (std::min(graph[x].size(), graph[y].size()) - 1.0);
+				tri_pairs += (t > 1.0 ? choose2(t) : 0.0);
+			}
+		}
+
+		// Average cost of an adjacency test (binary search)
+		double A = 1.0 + (n > 0 ? std::log2(1.0 + 2.0 * m / (double)n) : 0.0);
+
+		// Loop step counts follow the loop structure of count2..count5.
+		// The edge triangle pass costs M adjacency tests. Serial steps are
+		// those of count2, the complete graphlet passes of count4 and
+		// count5 and the common neighbour tables; all others are spread
+		// over the worker threads.
+		double serial = 0.0, parallel = 0.0;
+		est.common2_entries = 0.0;
+		est.common3_entries = 0.0;
+		est.two_hop_entries = 0.0;
+		if(graphlet_size == 2) {
+			serial = n;
+		}
+		else if(graphlet_size == 3) {
+			parallel = M * A + 2.0 * m;
+		}
+		else if(graphlet_size == 4) {
+			serial = 0.5 * D2 * A + 0.5 * tri_pairs * A;
+			parallel = M * A + 2.5 * D2 * A;
+		}
+		else if(graphlet_size == 5) {
+			serial = wedges + 3.0 * C3 * A + 0.5 * tri_pairs * A;
+			parallel = M * A + 2.0 * D2 * A + 5.0 * S * A + D2 * A + S + 3.0 * D3 * A;
+			est.common2_entries = wedges;
+			est.common3_entries = tri_pairs;
+			// every node's two-hop counts summed over all nodes
+			est.two_hop_entries = D2;
+		}
+		est.work = serial + parallel;
+
+		const unsigned int workers = parallel_workers(n, threads);
+
+		est.memory_graph = n * sizeof(int)
+			+ (n + 1) * sizeof(size_t)
+			+ 2 * m * sizeof(int)
+			+ 2 * m * sizeof(int);
+		est.memory_orbits = n * ORBITS[graphlet_size] * sizeof(int64_t);
+
+		// Tables that would exceed the memory budget are not built,
+		// as in Orca::setMemoryBudget()
+		size_t budget_left = std::numeric_limits<size_t>::max();
+		if(memory_budget > 0) {
+			size_t used = est.memory_graph + est.memory_orbits;
+			budget_left = (memory_budget > used ? memory_budget - used : 0);
+		}
+		size_t common2 = (size_t)(est.common2_entries * COMMON2_ENTRY_BYTES);
+		size_t common3 = (size_t)(est.common3_entries * COMMON3_ENTRY_BYTES);
+		if(common2 > budget_left) common2 = 0;
+		budget_left -= common2;
+		if(common3 > budget_left) common3 = 0;
+		budget_left -= common3;
+		est.memory_common = common2 + common3;
+
+		// Edge triangles, complete graphlet counts and neighbour lists,
+		// plus common neighbour arrays and a scratch row per worker
+		est.memory_temp = 0;
+		if(graphlet_size == 3) {
+			est.memory_temp = m * sizeof(int);
+		}
+		else if(graphlet_size == 4) {
+			est.memory_temp = m * sizeof(int) + n * sizeof(int64_t) + n * sizeof(int)
+				+ workers * 2 * n * sizeof(int);
+		}
+		else if(graphlet_size == 5) {
+			size_t two_hop = (size_t)(est.two_hop_entries * TWO_HOP_ENTRY_BYTES);
+			est.memory_temp = m * sizeof(int) + n * sizeof(int64_t) + 2 * n * sizeof(int)
+				+ workers * 4 * n * sizeof(int)
+				+ std::min(two_hop, std::min(cache_budget, budget_left));
+		}
+		est.memory_temp += workers * ORBITS[graphlet_size] * sizeof(int64_t);
+
+		est.memory_peak = est.memory_graph + est.memory_orbits
+			+ est.memory_common + est.memory_temp;
+
+		est.seconds = (serial + parallel / workers) * ns_per_step * 1e-9;
+
+		return est;
+	}
+
+	CostEstimate estimate(
+		size_t n,
+		const std::vector<std::pair<size_t,size_t>> &edges,
+		unsigned int graphlet_size,
+		size_t samples,
+		double ns_per_step,
+		unsigned int threads,
+		size_t memory_budget,
+		size_t cache_budget
+	) {
+		std::vector<size_t> offsets(n+1, 0);
+		for(auto &e : edges) {
+			offsets[e.first+1]++;
+			offsets[e.second+1]++;
+		}
+		for(size_t i = 0; i < n; ++i) {
+			offsets[i+1] += offsets[i];
+		}
+
+		std::vector<int> neighbours(offsets[n]);
+		std::vector<size_t> pos(offsets.begin(), offsets.end()-1);
+		for(auto &e : edges) {
+			neighbours[pos[e.first]++] = e.second;
+			neighbours[pos[e.second]++] = e.first;
+		}
+		for(size_t i = 0; i < n; ++i) {
+			std::sort(neighbours.begin() + offsets[i], neighbours.begin() + offsets[i+1]);
+		}
+
+		return estimate(CSR(n, offsets.data(), neighbours.data()), graphlet_size, samples, ns_per_step,
+			threads, memory_budget, cache_budget);
+	}
+}
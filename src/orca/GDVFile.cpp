@@ -0,0 +1,239 @@
+#include <orca/GDVFile.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <orca/Hash.hpp>
+
+namespace {
+	const char MAGIC[8] = { 'O', 'R', 'C', 'A', 'G', 'D', 'V', 'S' };
+	const uint32_t VERSION = 1;
+
+	// Rows are padded to this many values (64 bytes)
+	const size_t ROW_ALIGN = 8;
+	const size_t PAGE = 4096;
+
+	// Seed of the payload checksum
+	const uint64_t CHECKSUM_SEED = 0x47445646696c6531ULL;
+
+	// Rows written per fwrite call
+	const size_t WRITE_ROWS = 4096;
+
+	static_assert(sizeof(orca::GDVFileHeader) == 128, "Header must be 128 bytes");
+
+	inline size_t round_up(size_t x, size_t m) {
+		return (x + m - 1) / m * m;
+	}
+
+	bool write_zeros(FILE *file, size_t count) {
+		static const char zeros[PAGE] = { 0 };
+		while(count > 0) {
+			size_t c = std::min(count, PAGE);
+			if(fwrite(zeros, 1, c, file) != c) return false;
+			count -= c;
+		}
+		return true;
+	}
+}
+
+namespace orca {
+	void write_gdv_file(
+		const std::string &path,
+		const Orca &orca,
+		const std::vector<std::string> &labels
+	) {
+		write_gdv_file(path, orca, orca.key(), labels);
+	}
+
+	void write_gdv_file(
+		const std::string &path,
+		const Orca &orca,
+		const GraphKey &key,
+		const std::vector<std::string> &labels
+	) {
+		const Signature &sig = orca.getOrbits();
+		const size_t n = sig.size1();
+		const size_t orbits = sig.size2();
+		const size_t stride = round_up(orbits, ROW_ALIGN);
+		if(!labels.empty() && labels.size() != n) {
+			throw std::invalid_argument("Number of labels does not match number of nodes.");
+		}
+
+		GDVFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.header_size = sizeof(header);
+		header.graphlet_size = orca.graphletSize();
+		header.orbits = orbits;
+		header.nodes = n;
+		header.row_stride = stride;
+		header.data_offset = round_up(sizeof(header), PAGE);
+
+		header.key_hi = key.hi;
+		header.key_lo = key.lo;
+
+		const size_t data_end = header.data_offset + n * stride * sizeof(int64_t);
+		std::vector<uint64_t> offsets;
+		if(!labels.empty()) {
+			offsets.push_back(0);
+			for(auto &l : labels) offsets.push_back(offsets.back() + l.size());
+			header.labels_offset = data_end;
+			header.labels_size = offsets.size() * sizeof(uint64_t) + offsets.back();
+		}
+
+		FILE *file = fopen(path.c_str(), "wb");
+		if(!file) {
+			throw std::runtime_error("Could not open " + path + " for writing.");
+		}
+
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+			&& write_zeros(file, header.data_offset - sizeof(header));
+
+		// Rows are padded in a buffer, hashed and written in batches
+		Hasher hash(CHECKSUM_SEED);
+		std::vector<int64_t> buf(std::min(n, WRITE_ROWS) * stride, 0);
+		const int64_t *data = n > 0 ? &(sig.data()[0]) : nullptr;
+		for(size_t i0 = 0; i0 < n && ok; i0 += WRITE_ROWS) {
+			size_t i1 = std::min(i0 + WRITE_ROWS, n);
+			for(size_t i = i0; i < i1; ++i) {
+				std::copy(data + i*orbits, data + (i+1)*orbits, buf.begin() + (i - i0)*stride);
+			}
+			size_t count = (i1 - i0) * stride;
+			hash.add(buf.data(), count);
+			ok = fwrite(buf.data(), sizeof(int64_t), count, file) == count;
+		}
+
+		if(ok && !labels.empty()) {
+			ok = fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+			for(size_t i = 0; i < labels.size() && ok; ++i) {
+				ok = fwrite(labels[i].data(), 1, labels[i].size(), file) == labels[i].size();
+			}
+		}
+
+		// The checksum is known once the rows are written
+		header.checksum = std::max<uint64_t>(hash.digest(), 1);
+		ok = ok && fseek(file, 0, SEEK_SET) == 0
+			&& fwrite(&header, sizeof(header), 1, file) == 1;
+
+		if(fclose(file) != 0 || !ok) {
+			throw std::runtime_error("Error writing " + path + ".");
+		}
+	}
+
+	bool is_gdv_file(const std::string &path) {
+		FILE *file = fopen(path.c_str(), "rb");
+		if(!file) return false;
+		char magic[sizeof(MAGIC)];
+		bool match = fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+			&& memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+		fclose(file);
+		return match;
+	}
+
+	GDVFile::GDVFile(const std::string &path)
+	: map(nullptr)
+	, map_size(0)
+	, n(0)
+	, orbit_count(0)
+	, row_stride(0)
+	, graphlet_size(0)
+	, counts(nullptr)
+	, label_offsets(nullptr)
+	, label_chars(nullptr)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if(fd < 0) {
+			throw std::runtime_error("Could not open " + path + ".");
+		}
+
+		struct stat st;
+		if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(GDVFileHeader)) {
+			close(fd);
+			throw std::runtime_error(path + " is not a GDV file.");
+		}
+		map_size = st.st_size;
+
+		map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if(map == MAP_FAILED) {
+			map = nullptr;
+			throw std::runtime_error("Could not map " + path + ".");
+		}
+
+		const GDVFileHeader *header = (const GDVFileHeader*)map;
+		bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0
+			&& header->version == VERSION
+			&& header->header_size >= sizeof(GDVFileHeader)
+			&& header->graphlet_size >= 2 && header->graphlet_size <= 5
+			&& header->orbits == ORBITS[header->graphlet_size]
+			&& header->row_stride >= header->orbits
+			&& header->data_offset >= header->header_size
+			&& header->data_offset % sizeof(int64_t) == 0
+			&& header->data_offset <= map_size
+			&& (map_size - header->data_offset) / sizeof(int64_t) / header->row_stride >= header->nodes;
+
+		if(valid && header->labels_offset != 0) {
+			const size_t table = (header->nodes + 1) * sizeof(uint64_t);
+			valid = header->labels_offset % sizeof(uint64_t) == 0
+				&& header->labels_offset >= header->data_offset + header->nodes * header->row_stride * sizeof(int64_t)
+				&& header->labels_offset <= map_size
+				&& header->labels_size <= map_size - header->labels_offset
+				&& header->labels_size >= table;
+			if(valid) {
+				const uint64_t *offsets = (const uint64_t*)((const char*)map + header->labels_offset);
+				valid = offsets[0] == 0 && offsets[header->nodes] <= header->labels_size - table;
+				for(size_t i = 0; i < header->nodes && valid; ++i) {
+					valid = offsets[i] <= offsets[i+1];
+				}
+				label_offsets = offsets;
+				label_chars = (const char*)(offsets + header->nodes + 1);
+			}
+		}
+
+		if(!valid) {
+			munmap(map, map_size);
+			map = nullptr;
+			throw std::runtime_error(path + " is not a valid GDV file.");
+		}
+
+		n = header->nodes;
+		orbit_count = header->orbits;
+		row_stride = header->row_stride;
+		graphlet_size = header->graphlet_size;
+		counts = (const int64_t*)((const char*)map + header->data_offset);
+	}
+
+	GDVFile::~GDVFile() {
+		if(map) munmap(map, map_size);
+	}
+
+	GraphKey GDVFile::key() const {
+		GraphKey key = { header().key_hi, header().key_lo };
+		return key;
+	}
+
+	bool GDVFile::verify() const {
+		if(header().checksum == 0) return false;
+		Hasher hash(CHECKSUM_SEED);
+		hash.add(counts, n * row_stride);
+		return std::max<uint64_t>(hash.digest(), 1) == header().checksum;
+	}
+
+	std::string GDVFile::label(size_t i) const {
+		return std::string(label_chars + label_offsets[i], label_offsets[i+1] - label_offsets[i]);
+	}
+
+	std::vector<std::string> GDVFile::labels() const {
+		std::vector<std::string> out;
+		if(!hasLabels()) return out;
+		out.reserve(n);
+		for(size_t i = 0; i < n; ++i) out.push_back(label(i));
+		return out;
+	}
+}
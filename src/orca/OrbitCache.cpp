@@ -0,0 +1,133 @@
+#include <orca/OrbitCache.hpp>
+
+#include <cstdio>
+#include <ctime>
+#include <cerrno>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <unistd.h>
+
+namespace {
+	const char SUFFIX[] = ".gdv";
+	const size_t SUFFIX_LEN = sizeof(SUFFIX) - 1;
+	const char TEMP[] = ".gdv.tmp.";
+
+	// Temporary files not written to for this many seconds are left over
+	// from crashed writers and are deleted on eviction
+	const time_t STALE_TEMP = 3600;
+
+	// Distinguishes temporary files of threads in one process
+	std::atomic<unsigned long> temp_counter(0);
+
+	bool has_suffix(const std::string &name) {
+		return name.size() > SUFFIX_LEN && name.compare(name.size() - SUFFIX_LEN, SUFFIX_LEN, SUFFIX) == 0;
+	}
+}
+
+namespace orca {
+	OrbitCache::OrbitCache(const std::string &dir, uint64_t max_bytes)
+	: dir(dir)
+	, max_bytes(max_bytes)
+	{
+		if(mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+			throw std::runtime_error("Could not create cache directory " + dir + ".");
+		}
+		struct stat st;
+		if(stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+			throw std::runtime_error(dir + " is not a directory.");
+		}
+	}
+
+	std::string OrbitCache::path(const GraphKey &key) const {
+		return dir + "/" + key.hex() + SUFFIX;
+	}
+
+	std::unique_ptr<GDVFile> OrbitCache::open(const GraphKey &key, size_t nodes, int graphlet_size) const {
+		const std::string file = path(key);
+		if(access(file.c_str(), R_OK) != 0) return nullptr;
+
+		std::unique_ptr<GDVFile> gdv;
+		try {
+			gdv.reset(new GDVFile(file));
+		} catch(std::runtime_error&) {
+			unlink(file.c_str());
+			return nullptr;
+		}
+
+		if(gdv->key() != key || gdv->size() != nodes || gdv->graphletSize() != graphlet_size || !gdv->verify()) {
+			gdv.reset();
+			unlink(file.c_str());
+			return nullptr;
+		}
+
+		// Mark as recently used for eviction
+		utimes(file.c_str(), nullptr);
+		return gdv;
+	}
+
+	bool OrbitCache::store(const Orca &orca, const GraphKey &key) const {
+		const std::string file = path(key);
+		const std::string temp = file + ".tmp." + std::to_string(getpid()) + "." + std::to_string(temp_counter++);
+		try {
+			write_gdv_file(temp, orca, key);
+		} catch(std::runtime_error&) {
+			unlink(temp.c_str());
+			return false;
+		}
+		if(rename(temp.c_str(), file.c_str()) != 0) {
+			unlink(temp.c_str());
+			return false;
+		}
+
+		if(max_bytes > 0) evict(file);
+		return true;
+	}
+
+	void OrbitCache::evict(const std::string &keep) const {
+		struct Entry {
+			std::string path;
+			uint64_t size;
+			struct timespec used;
+		};
+
+		// Temporary files count against the limit while being written
+		std::vector<Entry> entries;
+		uint64_t total = 0;
+		const time_t now = time(nullptr);
+		DIR *d = opendir(dir.c_str());
+		if(!d) return;
+		while(struct dirent *e = readdir(d)) {
+			std::string name = e->d_name;
+			const bool temp = name.find(TEMP) != std::string::npos;
+			if(!temp && !has_suffix(name)) continue;
+
+			Entry entry = { dir + "/" + name, 0, { 0, 0 } };
+			struct stat st;
+			if(stat(entry.path.c_str(), &st) != 0) continue;
+			if(temp && now - st.st_mtime > STALE_TEMP) {
+				unlink(entry.path.c_str());
+				continue;
+			}
+			entry.size = st.st_size;
+			entry.used = st.st_mtim;
+			total += entry.size;
+			if(!temp && entry.path != keep) entries.push_back(entry);
+		}
+		closedir(d);
+
+		// Least recently used first, to the nanosecond, as entries are
+		// often stored and hit within the same second
+		std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+			if(a.used.tv_sec != b.used.tv_sec) return a.used.tv_sec < b.used.tv_sec;
+			return a.used.tv_nsec < b.used.tv_nsec;
+		});
+		for(size_t i = 0; i < entries.size() && total > max_bytes; ++i) {
+			if(unlink(entries[i].path.c_str()) == 0) total -= entries[i].size;
+		}
+	}
+}
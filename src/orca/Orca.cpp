@@ -1,9 +1,33 @@
 #include <orca/Orca.hpp>
+#include <orca/Parallel.hpp>
+#include <orca/Hash.hpp>
+#include <orca/GDVFile.hpp>
+#include <orca/OrbitCache.hpp>
 
+#include <cstdio>
 #include <cstring>
+#include <memory>
 #include <cmath>
 #include <functional>
 #include <algorithm>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+	// Approximate size of an unordered_map node (value, next pointer and
+	// cached hash) plus its share of the bucket array.
+	template<typename M>
+	size_t entry_bytes() {
+		return sizeof(typename M::value_type) + 3 * sizeof(void*);
+	}
+
+	template<typename M>
+	size_t table_bytes(const M &m) {
+		return m.size() * (sizeof(typename M::value_type) + 2 * sizeof(void*))
+			+ m.bucket_count() * sizeof(void*);
+	}
+}
 
 namespace orca {
 	Orca::Orca(
@@ -12,56 +36,314 @@ namespace orca {
 		unsigned int graphlet_size
 	)
 	: n(n)
-	, m(in_edges.size())
 	, graphlet_size(graphlet_size)
+	, memory_budget(0)
+	, threads(0)
+	, cache_budget(256 << 20)
+	, has_common2(false)
+	, has_common3(false)
 	, deg(n, 0)
 	{
 		if(graphlet_size < 2 || graphlet_size > 5) {
 			throw std::invalid_argument("Only graphlets of size 2-5 supported.");
 		}
 
-		// read input graph
-		edges.reserve(m);
+		build(n, in_edges, false, false);
+	}
+
+	Orca::Orca(
+		size_t n,
+		std::vector<std::pair<size_t,size_t>> &&in_edges,
+		unsigned int graphlet_size,
+		bool sorted,
+		bool validate
+	)
+	: n(n)
+	, graphlet_size(graphlet_size)
+	, memory_budget(0)
+	, threads(0)
+	, cache_budget(256 << 20)
+	, has_common2(false)
+	, has_common3(false)
+	, deg(n, 0)
+	{
+		if(graphlet_size < 2 || graphlet_size > 5) {
+			throw std::invalid_argument("Only graphlets of size 2-5 supported.");
+		}
+
+		build(n, in_edges, sorted, validate);
+
+		// edge list is no longer needed
+		std::vector<std::pair<size_t,size_t>>().swap(in_edges);
+	}
+
+	Orca::Orca(
+		const CSR &graph,
+		unsigned int graphlet_size,
+		bool validate
+	)
+	: n(graph.nodes())
+	, graphlet_size(graphlet_size)
+	, memory_budget(0)
+	, threads(0)
+	, cache_budget(256 << 20)
+	, has_common2(false)
+	, has_common3(false)
+	, deg(graph.nodes(), 0)
+	, adj(graph)
+	{
+		if(graphlet_size < 2 || graphlet_size > 5) {
+			throw std::invalid_argument("Only graphlets of size 2-5 supported.");
+		}
+
+		if(validate) validateCSR();
+
+		for(int x = 0; x < n; ++x) {
+			deg[x] = adj.offsets[x+1] - adj.offsets[x];
+		}
+
+		init();
+	}
+
+	template<typename E>
+	void Orca::build(size_t n, const E &in_edges, bool sorted, bool validate) {
+		if(validate) {
+			for(size_t i = 0; i < in_edges.size(); ++i) {
+				auto &e = in_edges[i];
+				if(e.first >= n || e.second >= n) {
+					throw std::invalid_argument("Edge endpoint out of range.");
+				}
+				if(e.first == e.second) {
+					throw std::invalid_argument("Self-loops not supported.");
+				}
+				if(sorted) {
+					if(e.first > e.second) {
+						throw std::invalid_argument("Sorted edges must be given as (a,b) with a < b.");
+					}
+					if(i > 0 && !(in_edges[i-1] < e)) {
+						throw std::invalid_argument("Edges not sorted or contain duplicates.");
+					}
+				}
+			}
+		}
+
+		// Set up adjacency lists in CSR form
 		for(auto &e : in_edges) {
 			deg[e.first]++;
 			deg[e.second]++;
-			edges.emplace_back(e.first, e.second);
 		}
 
-		// Set up adjacency, incidence lists
-		adj.resize(n);
+		adj_offsets.resize(n+1);
+		adj_offsets[0] = 0;
 		for(size_t i = 0; i < n; ++i) {
-			adj[i].resize(deg[i]);
+			adj_offsets[i+1] = adj_offsets[i] + deg[i];
 		}
 
-		inc.resize(n);
-		for(size_t i = 0; i < n; ++i) {
-			inc[i].resize(deg[i]);
+		adj_neighbours.resize(adj_offsets[n]);
+		std::vector<size_t> pos(adj_offsets.begin(), adj_offsets.end()-1);
+		for(auto &e : in_edges) {
+			adj_neighbours[pos[e.first]++] = e.second;
+			adj_neighbours[pos[e.second]++] = e.first;
 		}
 
-		std::vector<int> d(n);
-		std::fill(d.begin(), d.end(), 0);
-		for(int i = 0; i < m; i++) {
-			int a = edges[i].a;
-			int b = edges[i].b;
-			adj[a][d[a]] = b;
-			adj[b][d[b]] = a;
-			inc[a][d[a]] = std::pair<int,int>(b,i);
-			inc[b][d[b]] = std::pair<int,int>(a,i);
-			d[a]++; d[b]++;
+		// Sorted edge lists produce sorted rows: lower neighbours are
+		// inserted before higher ones, both in ascending order.
+		if(!sorted) {
+			for(size_t i = 0; i < n; ++i) {
+				std::sort(
+					adj_neighbours.begin() + adj_offsets[i],
+					adj_neighbours.begin() + adj_offsets[i+1]
+				);
+			}
+
+			if(validate) {
+				for(size_t i = 0; i < n; ++i) {
+					for(size_t j = adj_offsets[i]+1; j < adj_offsets[i+1]; ++j) {
+						if(adj_neighbours[j-1] == adj_neighbours[j]) {
+							throw std::invalid_argument("Duplicate edges not supported.");
+						}
+					}
+				}
+			}
 		}
-		for(size_t i = 0; i < n; i++) {
-			std::sort(adj[i].begin(), adj[i].end());
-			std::sort(inc[i].begin(), inc[i].end());
+
+		adj = CSR(n, adj_offsets.data(), adj_neighbours.data());
+
+		init();
+	}
+
+	void Orca::init() {
+		m = adj.edges();
+
+		// Number edges in order of their lower endpoint. Rows are sorted, so
+		// the mirrored entries in the upper endpoint's row are reached in order.
+		edge_ids.resize(2*m);
+		std::vector<size_t> pos(adj.offsets, adj.offsets + n);
+		int id = 0;
+		for(int x = 0; x < n; ++x) {
+			for(size_t i = adj.offsets[x]; i < adj.offsets[x+1]; ++i) {
+				int y = adj.neighbours[i];
+				if(y < x) continue;
+				edge_ids[i] = id;
+				edge_ids[pos[y]++] = id;
+				id++;
+			}
 		}
+		inc = Incidence(adj, edge_ids.data());
+
 		// initialize orbit counts
+		sink = nullptr;
+		orbit_cache = nullptr;
 		orbit.resize(n, ORBITS[graphlet_size]);
 		for(auto it = orbit.begin1(); it != orbit.end1(); ++it) {
 			std::fill(it.begin(), it.end(), 0);
 		}
 	}
 
+	void Orca::validateCSR() const {
+		if(adj.offsets[0] != 0) {
+			throw std::invalid_argument("CSR offsets must start at 0.");
+		}
+		for(int x = 0; x < n; ++x) {
+			if(adj.offsets[x+1] < adj.offsets[x]) {
+				throw std::invalid_argument("CSR offsets not monotone.");
+			}
+			Row<int> row = adj[x];
+			for(size_t i = 0; i < row.size(); ++i) {
+				int y = row[i];
+				if(y < 0 || y >= n) {
+					throw std::invalid_argument("Edge endpoint out of range.");
+				}
+				if(y == x) {
+					throw std::invalid_argument("Self-loops not supported.");
+				}
+				if(i > 0 && row[i-1] >= y) {
+					throw std::invalid_argument("CSR rows not sorted or contain duplicates.");
+				}
+			}
+		}
+		for(int x = 0; x < n; ++x) {
+			for(int y : adj[x]) {
+				if(!adjacent(y, x)) {
+					throw std::invalid_argument("CSR graph not symmetric.");
+				}
+			}
+		}
+	}
+
+	void Orca::countEdgeTriangles(std::vector<int> &tri) const {
+		// Each edge is owned by its lower endpoint and counted independently
+		// by looking up the shorter adjacency list in the longer one, which
+		// keeps the cost per edge at O(min(deg) log(max(deg))).
+		tri.assign(m, 0);
+		parallel_for(0, n, [&](size_t x) {
+			for(int nx = 0; nx < deg[x]; nx++) {
+				int y = adj[x][nx];
+				if(y < (int)x) continue;
+				Row<int> small = adj[x], large = adj[y];
+				if(small.size() > large.size()) std::swap(small, large);
+				int t = 0;
+				for(int z : small) {
+					if(std::binary_search(large.begin(), large.end(), z)) t++;
+				}
+				tri[inc[x][nx].second] = t;
+			}
+		}, threads);
+	}
+
 	void Orca::compute() {
+		// the key hashes every edge, so it is computed once per call
+		GraphKey graph_key = {};
+		if(orbit_cache) {
+			graph_key = key();
+			if(load(graph_key, nullptr)) return;
+		}
+
+		// a previous streaming run released the signature
+		if(orbit.size1() != (size_t)n) {
+			orbit.resize(n, ORBITS[graphlet_size], false);
+			for(auto it = orbit.begin1(); it != orbit.end1(); ++it) {
+				std::fill(it.begin(), it.end(), 0);
+			}
+		}
+		sink = nullptr;
+		dispatch();
+
+		if(orbit_cache) orbit_cache->store(*this, graph_key);
+	}
+
+	void Orca::compute(const OrbitSink &out) {
+		if(orbit_cache && load(key(), &out)) return;
+
+		// Only one row per worker is kept; the full signature is released,
+		// so a cache miss is not stored
+		orbit.resize(0, 0, false);
+		scratch.assign(workers(), std::vector<int64_t>(ORBITS[graphlet_size]));
+		sink = &out;
+		try {
+			dispatch();
+		} catch(...) {
+			sink = nullptr;
+			throw;
+		}
+		sink = nullptr;
+		scratch.clear();
+	}
+
+	bool Orca::load(const GraphKey &graph_key, const OrbitSink *out) {
+		std::unique_ptr<GDVFile> file = orbit_cache->open(graph_key, n, graphlet_size);
+		if(!file) return false;
+
+		if(out) {
+			orbit.resize(0, 0, false);
+			for(int x = 0; x < n; ++x) (*out)(0, x, file->row(x));
+		} else {
+			const size_t orbits = ORBITS[graphlet_size];
+			orbit.resize(n, orbits, false);
+			for(int x = 0; x < n; ++x) {
+				std::copy(file->row(x), file->row(x) + orbits, &orbit(x, 0));
+			}
+		}
+		return true;
+	}
+
+	GraphKey Orca::key() const {
+		// Rows are sorted, so visiting the upper neighbours of every node
+		// in order yields the normalized edge list
+		Hasher h1(0x6f726361), h2(0x67726170686c6574);
+		for(Hasher *h : { &h1, &h2 }) {
+			h->add(n);
+			h->add(graphlet_size);
+			h->add(m);
+		}
+		for(int x = 0; x < n; ++x) {
+			for(int y : adj[x]) {
+				if(y < x) continue;
+				h1.add(x);
+				h1.add(y);
+				h2.add(x);
+				h2.add(y);
+			}
+		}
+		GraphKey key = { h1.digest(), h2.digest() };
+		return key;
+	}
+
+	std::string GraphKey::hex() const {
+		char buf[33];
+		snprintf(buf, sizeof(buf), "%016llx%016llx", (unsigned long long)hi, (unsigned long long)lo);
+		return std::string(buf);
+	}
+
+	void Orca::setOrbitCache(const OrbitCache *cache) {
+		orbit_cache = cache;
+	}
+
+	unsigned int Orca::workers() const {
+		return parallel_workers(n, threads);
+	}
+
+	void Orca::dispatch() {
 		if(graphlet_size == 2) count2();
 		else if(graphlet_size == 3) count3();
 		else if(graphlet_size == 4) count4();
@@ -74,57 +356,40 @@ namespace orca {
 
 	void Orca::count2() {
 		for(int x = 0; x < n; ++x) {
-			orbit(x, 0) = deg[x];
+			int64_t *o = row(x, 0);
+			o[0] = deg[x];
+			emit(x, 0, o);
 		}
 	}
 
 	void Orca::count3() {
-		// set up a system of equations relating orbits for every node
-		for (int x = 0; x < n; x++) {
-			orbit(x, 0) = deg[x];
-			// x - middle node
-			for (int nx1 = 0; nx1 < deg[x]; nx1++) {
-				int y=inc[x][nx1].first;
-				for (int nx2 = nx1+1; nx2 < deg[x]; nx2++) {
-					int z = inc[x][nx2].first;
-					if (adjacent(y,z)) { // triangle
-						orbit(x, 3)++;
-					} else { // path
-						orbit(x, 2)++;
-					}
-				}
-			}
-			// x - side node
-			for (int nx1 = 0; nx1 < deg[x]; nx1++) {
-				int y=inc[x][nx1].first;
-				for (int ny=0; ny < deg[y]; ny++) {
-					int z = inc[y][ny].first;
-					if (x == z) continue;
-					if (!adjacent(x,z)) { // path
-						orbit(x, 1)++;
-					}
-				}
+		// size 3 orbits follow from degrees and triangles per node
+		std::vector<int> tri;
+		countEdgeTriangles(tri);
+
+		parallel_for_workers(0, n, [&](unsigned int w, size_t x) {
+			int64_t t = 0, walks = 0;
+			for (int nx = 0; nx < deg[x]; nx++) {
+				int y = inc[x][nx].first;
+				t += tri[inc[x][nx].second];
+				walks += deg[y]-1;
 			}
-		}
+			t /= 2; // every triangle is seen from both of its edges at x
+
+			int64_t d = deg[x];
+			int64_t *o = row(x, w);
+			o[0] = d;
+			o[3] = t;                // triangle
+			o[2] = d*(d-1)/2 - t;    // x - middle node of path
+			o[1] = walks - 2*t;      // x - side node of path
+			emit(x, w, o);
+		}, threads);
 	}
 
 	void Orca::count4() {
 		// precompute triangles that span over edges
-		std::vector<int> tri(m, 0);
-		for (int i=0; i < m; i++) {
-			int x=edges[i].a, y=edges[i].b;
-			for (int xi=0, yi=0; xi<deg[x] && yi<deg[y]; ) {
-				if (adj[x][xi] == adj[y][yi]) {
-					tri[i]++;
-					xi++;
-					yi++;
-				} else if (adj[x][xi] < adj[y][yi]) {
-					xi++;
-				} else {
-					yi++;
-				}
-			}
-		}
+		std::vector<int> tri;
+		countEdgeTriangles(tri);
 
 		// count full graphlets
 		std::vector<int64_t> C4(n, 0);
@@ -153,11 +418,25 @@ namespace orca {
 			}
 		}
 
-		// set up a system of equations relating orbits for every node
-		std::vector<int> common(n, 0);
-		std::vector<int> common_list(n);
-		int nc = 0;
-		for (int x = 0; x < n; x++) {
+		// set up a system of equations relating orbits for every node,
+		// with separate common neighbour counts for every worker
+		struct Common {
+			std::vector<int> count, list;
+			int size;
+		};
+		std::vector<Common> commons(workers());
+		parallel_for_workers(0, n, [&](unsigned int w, size_t node) {
+			int x = (int)node;
+			Common &cw = commons[w];
+			if (cw.count.empty()) {
+				cw.count.assign(n, 0);
+				cw.list.resize(n);
+				cw.size = 0;
+			}
+			std::vector<int> &common = cw.count;
+			std::vector<int> &common_list = cw.list;
+			int &nc = cw.size;
+
 			int64_t f_12_14=0, f_10_13=0;
 			int64_t f_13_14=0, f_11_13=0;
 			int64_t f_7_11=0, f_5_8=0;
@@ -167,7 +446,8 @@ namespace orca {
 			for (int i=0; i < nc; i++) common[common_list[i]]=0;
 			nc=0;
 
-			orbit(x, 0) = deg[x];
+			int64_t *o = row(x, w);
+			o[0] = deg[x];
 			// x - middle node
 			for (int nx1 = 0; nx1 < deg[x]; nx1++) {
 				int y=inc[x][nx1].first, ey=inc[x][nx1].second;
@@ -188,11 +468,11 @@ namespace orca {
 					int z = inc[x][nx2].first;
 					int ez = inc[x][nx2].second;
 					if (adjacent(y,z)) { // triangle
-						orbit(x, 3)++;
+						o[3]++;
 						f_13_14 += (tri[ey]-1)+(tri[ez]-1);
 						f_11_13 += (deg[x]-1-tri[ey])+(deg[x]-1-tri[ez]);
 					} else { // path
-						orbit(x, 2)++;
+						o[2]++;
 						f_7_11 += (deg[x]-1-tri[ey]-1)+(deg[x]-1-tri[ez]-1);
 						f_5_8 += (deg[y]-1-tri[ey])+(deg[z]-1-tri[ez]);
 					}
@@ -206,7 +486,7 @@ namespace orca {
 					int ez = inc[y][ny].second;
 					if (x == z) continue;
 					if (!adjacent(x,z)) { // path
-						orbit(x, 1)++;
+						o[1]++;
 						f_6_9 += (deg[y]-1-tri[ey]-1);
 						f_9_12 += tri[ez];
 						f_4_8 += (deg[z]-1-tri[ez]);
@@ -216,57 +496,28 @@ namespace orca {
 			}
 
 			// solve system of equations
-			orbit(x, 14) = (f_14);
-			orbit(x, 13) = (f_13_14-6*f_14)/2;
-			orbit(x, 12) = (f_12_14-3*f_14);
-			orbit(x, 11) = (f_11_13-f_13_14+6*f_14)/2;
-			orbit(x, 10) = (f_10_13-f_13_14+6*f_14);
-			orbit(x, 9)  = (f_9_12-2*f_12_14+6*f_14)/2;
-			orbit(x, 8)  = (f_8_12-2*f_12_14+6*f_14)/2;
-			orbit(x, 7)  = (f_13_14+f_7_11-f_11_13-6*f_14)/6;
-			orbit(x, 6)  = (2*f_12_14+f_6_9-f_9_12-6*f_14)/2;
-			orbit(x, 5)  = (2*f_12_14+f_5_8-f_8_12-6*f_14);
-			orbit(x, 4)  = (2*f_12_14+f_4_8-f_8_12-6*f_14);
-		}
+			o[14] = (f_14);
+			o[13] = (f_13_14-6*f_14)/2;
+			o[12] = (f_12_14-3*f_14);
+			o[11] = (f_11_13-f_13_14+6*f_14)/2;
+			o[10] = (f_10_13-f_13_14+6*f_14);
+			o[9]  = (f_9_12-2*f_12_14+6*f_14)/2;
+			o[8]  = (f_8_12-2*f_12_14+6*f_14)/2;
+			o[7]  = (f_13_14+f_7_11-f_11_13-6*f_14)/6;
+			o[6]  = (2*f_12_14+f_6_9-f_9_12-6*f_14)/2;
+			o[5]  = (2*f_12_14+f_5_8-f_8_12-6*f_14);
+			o[4]  = (2*f_12_14+f_4_8-f_8_12-6*f_14);
+			emit(x, w, o);
+		}, threads);
 	}
 
 	void Orca::count5() {
 		// precompute common nodes
-		for (int x = 0; x < n; x++) {
-			for (int n1 = 0; n1 < deg[x]; n1++) {
-				int a = adj[x][n1];
-				for (int n2 = n1+1; n2<deg[x]; n2++) {
-					int b = adj[x][n2];
-					Pair ab = Pair(a,b);
-					common2[ab]++;
-					for (int n3 = n2+1; n3 < deg[x]; n3++) {
-						int c = adj[x][n3];
-						int st = adjacent(a,b)+adjacent(a,c)+adjacent(b,c);
-						if (st < 2) continue;
-						Triple abc = Triple(a,b,c);
-						common3[abc]++;
-					}
-				}
-			}
-		}
+		precomputeCommon();
+
 		// precompute triangles that span over edges
-		std::vector<int> tri(m, 0);
-		for (int i = 0; i < m; i++) {
-			int x = edges[i].a, y=edges[i].b;
-			for (int xi = 0, yi=0; xi < deg[x] && yi < deg[y]; ) {
-				if (adj[x][xi] == adj[y][yi]) {
-					tri[i]++;
-					xi++;
-					yi++;
-				}
-				else if (adj[x][xi] < adj[y][yi]) {
-					xi++;
-				}
-				else {
-					yi++;
-				}
-			}
-		}
+		std::vector<int> tri;
+		countEdgeTriangles(tri);
 
 		// count full graphlets
 		std::vector<int64_t> C5(n, 0);
@@ -307,33 +558,71 @@ namespace orca {
 			}
 		}
 
-		std::vector<int> common_x(n, 0);
-		std::vector<int> common_x_list(n);
-		int ncx = 0;
-		std::vector<int> common_a(n, 0);
-		std::vector<int> common_a_list(n);
-		int nca = 0;
+		// Two-hop counts of a node are reused for all of its neighbours x.
+		// A cached entry expires once x has passed the node's last neighbour.
+		// Every worker visits its nodes in increasing order and keeps its
+		// own cache within an equal share of the budget.
+		struct Common {
+			std::vector<int> common_x, common_x_list;
+			std::vector<int> common_a, common_a_list;
+			int ncx, nca;
+			std::unordered_map<int, std::vector<std::pair<int,int>>> two_hop;
+			std::priority_queue<
+				std::pair<int,int>,
+				std::vector<std::pair<int,int>>,
+				std::greater<std::pair<int,int>>
+			> two_hop_expiry;
+			size_t two_hop_bytes;
+		};
+		std::vector<Common> commons(workers());
+		size_t cache_left = cache_budget;
+		if (memory_budget > 0) {
+			size_t used = memoryUsage().total();
+			cache_left = std::min(cache_left, memory_budget > used ? memory_budget - used : 0);
+		}
+		cache_left /= commons.size();
 
 		// set up a system of equations relating orbit counts
-		for (int x = 0; x < n; x++) {
+		parallel_for_workers(0, n, [&](unsigned int w, size_t node) {
+			int x = (int)node;
+			Common &cw = commons[w];
+			if (cw.common_x.empty()) {
+				cw.common_x.assign(n, 0);
+				cw.common_x_list.resize(n);
+				cw.common_a.assign(n, 0);
+				cw.common_a_list.resize(n);
+				cw.ncx = cw.nca = 0;
+				cw.two_hop_bytes = 0;
+			}
+			std::vector<int> &common_x = cw.common_x;
+			std::vector<int> &common_x_list = cw.common_x_list;
+			int &ncx = cw.ncx;
+			std::vector<int> &common_a = cw.common_a;
+			std::vector<int> &common_a_list = cw.common_a_list;
+			int &nca = cw.nca;
+			auto &two_hop = cw.two_hop;
+			auto &two_hop_expiry = cw.two_hop_expiry;
+			size_t &two_hop_bytes = cw.two_hop_bytes;
+
 			for (int i = 0; i < ncx; i++) {
 				common_x[common_x_list[i]]=0;
 			}
 			ncx=0;
 
 			// smaller graphlets
-			orbit(x, 0) = deg[x];
+			int64_t *o = row(x, w);
+			o[0] = deg[x];
 			for (int nx1 = 0; nx1 < deg[x]; nx1++) {
 				int a = adj[x][nx1];
 				for (int nx2 = nx1+1; nx2 < deg[x]; nx2++) {
 					int b = adj[x][nx2];
-					if (adjacent(a,b)) orbit(x, 3)++;
-					else orbit(x, 2)++;
+					if (adjacent(a,b)) o[3]++;
+					else o[2]++;
 				}
 				for (int na = 0; na < deg[a]; na++) {
 					int b = adj[a][na];
 					if (b != x && !adjacent(x,b)) {
-						orbit(x, 1)++;
+						o[1]++;
 						if (common_x[b] == 0) {
 							common_x_list[ncx++] = b;
 						}
@@ -362,13 +651,32 @@ namespace orca {
 					common_a[common_a_list[i]]=0;
 				}
 				nca = 0;
-				for (int na = 0; na < deg[a]; na++) {
-					int b = adj[a][na];
-					for (int nb = 0; nb < deg[b]; nb++) {
-						int c = adj[b][nb];
-						if (c==a || adjacent(a,c)) continue;
-						if (common_a[c]==0) common_a_list[nca++] = c;
-						common_a[c]++;
+				auto cached = two_hop.find(a);
+				if (cached != two_hop.end()) {
+					for (auto &h : cached->second) {
+						common_a_list[nca++] = h.first;
+						common_a[h.first] = h.second;
+					}
+				} else {
+					for (int na = 0; na < deg[a]; na++) {
+						int b = adj[a][na];
+						for (int nb = 0; nb < deg[b]; nb++) {
+							int c = adj[b][nb];
+							if (c==a || adjacent(a,c)) continue;
+							if (common_a[c]==0) common_a_list[nca++] = c;
+							common_a[c]++;
+						}
+					}
+					// keep the counts while other neighbours of a remain
+					size_t bytes = nca * sizeof(std::pair<int,int>);
+					if (deg[a] > 1 && two_hop_bytes + bytes <= cache_left) {
+						std::vector<std::pair<int,int>> &h = two_hop[a];
+						h.reserve(nca);
+						for (int i = 0; i < nca; i++) {
+							h.emplace_back(common_a_list[i], common_a[common_a_list[i]]);
+						}
+						two_hop_bytes += bytes;
+						two_hop_expiry.push(std::make_pair(adj[a][deg[a]-1], a));
 					}
 				}
 
@@ -381,7 +689,7 @@ namespace orca {
 						int c = inc[x][nx3].first;
 						int xc = inc[x][nx3].second;
 						if (!adjacent(a,c) || !adjacent(b,c)) continue;
-						orbit(x, 14)++;
+						o[14]++;
 						f_70 += common3_get(a,b,c)-1;
 						f_71 += (tri[xa]>2 && tri[xb]>2)?(common3_get(x,a,b)-1):0;
 						f_71 += (tri[xa]>2 && tri[xc]>2)?(common3_get(x,a,c)-1):0;
@@ -404,7 +712,7 @@ namespace orca {
 						int c = inc[x][nx3].first;
 						int xc = inc[x][nx3].second;
 						if (!adjacent(a,c) || adjacent(b,c)) continue;
-						orbit(x, 13)++;
+						o[13]++;
 						f_69 += (tri[xb]>1 && tri[xc]>1)?(common3_get(x,b,c)-1):0;
 						f_68 += common3_get(a,b,c)-1;
 						f_64 += common2_get(b,c)-2;
@@ -426,7 +734,7 @@ namespace orca {
 						int c = inc[a][na].first;
 						int ac = inc[a][na].second;
 						if (c==x || adjacent(x,c) || !adjacent(b,c)) continue;
-						orbit(x, 12)++;
+						o[12]++;
 						f_65 += (tri[ac]>1)?common3_get(a,b,c):0;
 						f_63 += common_x[c]-2;
 						f_59 += tri[ac]-1+common2_get(b,c)-1;
@@ -444,7 +752,7 @@ namespace orca {
 					for (int na = 0; na < deg[a]; na++) {
 						int c=inc[a][na].first, ac=inc[a][na].second;
 						if (c==x || adjacent(x,c) || !adjacent(b,c)) continue;
-						orbit(x, 8)++;
+						o[8]++;
 						f_62 += (tri[ac]>0)?common3_get(a,b,c):0;
 						f_53 += tri[xa]+tri[xb];
 						f_51 += tri[ac]+common2_get(c,b);
@@ -463,7 +771,7 @@ namespace orca {
 					for (int nx3 = 0; nx3 < deg[x]; nx3++) {
 						int c=inc[x][nx3].first, xc=inc[x][nx3].second;
 						if (c==a || c==b || adjacent(a,c) || adjacent(b,c)) continue;
-						orbit(x, 11)++;
+						o[11]++;
 						f_44 += tri[xc];
 						f_33 += deg[x]-3;
 						f_30 += deg[c]-1;
@@ -478,7 +786,7 @@ namespace orca {
 					for (int nb = 0; nb < deg[b]; nb++) {
 						int c=inc[b][nb].first, bc=inc[b][nb].second;
 						if (c==x || c==a || adjacent(a,c) || adjacent(x,c)) continue;
-						orbit(x, 10)++;
+						o[10]++;
 						f_52 += common_a[c]-1;
 						f_43 += tri[bc];
 						f_32 += deg[b]-3;
@@ -494,7 +802,7 @@ namespace orca {
 					for (int na2 = na1+1; na2 < deg[a]; na2++) {
 						int c=inc[a][na2].first, ac=inc[a][na2].second;
 						if (c==x || !adjacent(b,c) || adjacent(x,c)) continue;
-						orbit(x, 9)++;
+						o[9]++;
 						f_56 += (tri[ab]>1 && tri[ac]>1)?common3_get(a,b,c):0;
 						f_45 += common2_get(b,c)-1;
 						f_39 += tri[ab]-1+tri[ac]-1;
@@ -511,7 +819,7 @@ namespace orca {
 					for (int nb = 0; nb < deg[b]; nb++) {
 						int c=inc[b][nb].first, bc=inc[b][nb].second;
 						if (c==a || adjacent(a,c) || adjacent(x,c)) continue;
-						orbit(x, 4)++;
+						o[4]++;
 						f_35 += common_a[c]-1;
 						f_34 += common_x[c];
 						f_27 += tri[bc];
@@ -528,7 +836,7 @@ namespace orca {
 					for (int nb = 0; nb < deg[b]; nb++) {
 						int c=inc[b][nb].first;
 						if (c==x || adjacent(a,c) || adjacent(x,c)) continue;
-						orbit(x, 5)++;
+						o[5]++;
 						f_17 += deg[a]-1;
 					}
 				}
@@ -540,7 +848,7 @@ namespace orca {
 					for (int na2 = na1+1; na2 < deg[a]; na2++) {
 						int c=inc[a][na2].first;
 						if (c==x || adjacent(x,c) || adjacent(b,c)) continue;
-						orbit(x, 6)++;
+						o[6]++;
 						f_22 += deg[a]-3;
 						f_20 += deg[x]-1;
 						f_19 += deg[b]-1+deg[c]-1;
@@ -554,7 +862,7 @@ namespace orca {
 					for (int nx3 = nx2+1; nx3 < deg[x]; nx3++) {
 						int c=inc[x][nx3].first;
 						if (adjacent(a,c) || adjacent(b,c)) continue;
-						orbit(x, 7)++;
+						o[7]++;
 						f_23 += deg[x]-3;
 						f_21 += deg[a]-1+deg[b]-1+deg[c]-1;
 					}
@@ -562,77 +870,163 @@ namespace orca {
 			}
 
 			// solve equations
-			orbit(x, 72) = C5[x];
-			orbit(x, 71) = (f_71-12*orbit(x, 72))/2;
-			orbit(x, 70) = (f_70-4*orbit(x, 72));
-			orbit(x, 69) = (f_69-2*orbit(x, 71))/4;
-			orbit(x, 68) = (f_68-2*orbit(x, 71));
-			orbit(x, 67) = (f_67-12*orbit(x, 72)-4*orbit(x, 71));
-			orbit(x, 66) = (f_66-12*orbit(x, 72)-2*orbit(x, 71)-3*orbit(x, 70));
-			orbit(x, 65) = (f_65-3*orbit(x, 70))/2;
-			orbit(x, 64) = (f_64-2*orbit(x, 71)-4*orbit(x, 69)-1*orbit(x, 68));
-			orbit(x, 63) = (f_63-3*orbit(x, 70)-2*orbit(x, 68));
-			orbit(x, 62) = (f_62-1*orbit(x, 68))/2;
-			orbit(x, 61) = (f_61-4*orbit(x, 71)-8*orbit(x, 69)-2*orbit(x, 67))/2;
-			orbit(x, 60) = (f_60-4*orbit(x, 71)-2*orbit(x, 68)-2*orbit(x, 67));
-			orbit(x, 59) = (f_59-6*orbit(x, 70)-2*orbit(x, 68)-4*orbit(x, 65));
-			orbit(x, 58) = (f_58-4*orbit(x, 72)-2*orbit(x, 71)-1*orbit(x, 67));
-			orbit(x, 57) = (f_57-12*orbit(x, 72)-4*orbit(x, 71)-3*orbit(x, 70)-1*orbit(x, 67)-2*orbit(x, 66));
-			orbit(x, 56) = (f_56-2*orbit(x, 65))/3;
-			orbit(x, 55) = (f_55-2*orbit(x, 71)-2*orbit(x, 67))/3;
-			orbit(x, 54) = (f_54-3*orbit(x, 70)-1*orbit(x, 66)-2*orbit(x, 65))/2;
-			orbit(x, 53) = (f_53-2*orbit(x, 68)-2*orbit(x, 64)-2*orbit(x, 63));
-			orbit(x, 52) = (f_52-2*orbit(x, 66)-2*orbit(x, 64)-1*orbit(x, 59))/2;
-			orbit(x, 51) = (f_51-2*orbit(x, 68)-2*orbit(x, 63)-4*orbit(x, 62));
-			orbit(x, 50) = (f_50-1*orbit(x, 68)-2*orbit(x, 63))/3;
-			orbit(x, 49) = (f_49-1*orbit(x, 68)-1*orbit(x, 64)-2*orbit(x, 62))/2;
-			orbit(x, 48) = (f_48-4*orbit(x, 71)-8*orbit(x, 69)-2*orbit(x, 68)-2*orbit(x, 67)-2*orbit(x, 64)-2*orbit(x, 61)-1*orbit(x, 60));
-			orbit(x, 47) = (f_47-3*orbit(x, 70)-2*orbit(x, 68)-1*orbit(x, 66)-1*orbit(x, 63)-1*orbit(x, 60));
-			orbit(x, 46) = (f_46-3*orbit(x, 70)-2*orbit(x, 68)-2*orbit(x, 65)-1*orbit(x, 63)-1*orbit(x, 59));
-			orbit(x, 45) = (f_45-2*orbit(x, 65)-2*orbit(x, 62)-3*orbit(x, 56));
-			orbit(x, 44) = (f_44-1*orbit(x, 67)-2*orbit(x, 61))/4;
-			orbit(x, 43) = (f_43-2*orbit(x, 66)-1*orbit(x, 60)-1*orbit(x, 59))/2;
-			orbit(x, 42) = (f_42-2*orbit(x, 71)-4*orbit(x, 69)-2*orbit(x, 67)-2*orbit(x, 61)-3*orbit(x, 55));
-			orbit(x, 41) = (f_41-2*orbit(x, 71)-1*orbit(x, 68)-2*orbit(x, 67)-1*orbit(x, 60)-3*orbit(x, 55));
-			orbit(x, 40) = (f_40-6*orbit(x, 70)-2*orbit(x, 68)-2*orbit(x, 66)-4*orbit(x, 65)-1*orbit(x, 60)-1*orbit(x, 59)-4*orbit(x, 54));
-			orbit(x, 39) = (f_39-4*orbit(x, 65)-1*orbit(x, 59)-6*orbit(x, 56))/2;
-			orbit(x, 38) = (f_38-1*orbit(x, 68)-1*orbit(x, 64)-2*orbit(x, 63)-1*orbit(x, 53)-3*orbit(x, 50));
-			orbit(x, 37) = (f_37-2*orbit(x, 68)-2*orbit(x, 64)-2*orbit(x, 63)-4*orbit(x, 62)-1*orbit(x, 53)-1*orbit(x, 51)-4*orbit(x, 49));
-			orbit(x, 36) = (f_36-1*orbit(x, 68)-2*orbit(x, 63)-2*orbit(x, 62)-1*orbit(x, 51)-3*orbit(x, 50));
-			orbit(x, 35) = (f_35-1*orbit(x, 59)-2*orbit(x, 52)-2*orbit(x, 45))/2;
-			orbit(x, 34) = (f_34-1*orbit(x, 59)-2*orbit(x, 52)-1*orbit(x, 51))/2;
-			orbit(x, 33) = (f_33-1*orbit(x, 67)-2*orbit(x, 61)-3*orbit(x, 58)-4*orbit(x, 44)-2*orbit(x, 42))/2;
-			orbit(x, 32) = (f_32-2*orbit(x, 66)-1*orbit(x, 60)-1*orbit(x, 59)-2*orbit(x, 57)-2*orbit(x, 43)-2*orbit(x, 41)-1*orbit(x, 40))/2;
-			orbit(x, 31) = (f_31-2*orbit(x, 65)-1*orbit(x, 59)-3*orbit(x, 56)-1*orbit(x, 43)-2*orbit(x, 39));
-			orbit(x, 30) = (f_30-1*orbit(x, 67)-1*orbit(x, 63)-2*orbit(x, 61)-1*orbit(x, 53)-4*orbit(x, 44));
-			orbit(x, 29) = (f_29-2*orbit(x, 66)-2*orbit(x, 64)-1*orbit(x, 60)-1*orbit(x, 59)-1*orbit(x, 53)-2*orbit(x, 52)-2*orbit(x, 43));
-			orbit(x, 28) = (f_28-2*orbit(x, 65)-2*orbit(x, 62)-1*orbit(x, 59)-1*orbit(x, 51)-1*orbit(x, 43));
-			orbit(x, 27) = (f_27-1*orbit(x, 59)-1*orbit(x, 51)-2*orbit(x, 45))/2;
-			orbit(x, 26) = (f_26-2*orbit(x, 67)-2*orbit(x, 63)-2*orbit(x, 61)-6*orbit(x, 58)-1*orbit(x, 53)-2*orbit(x, 47)-2*orbit(x, 42));
-			orbit(x, 25) = (f_25-2*orbit(x, 66)-2*orbit(x, 64)-1*orbit(x, 59)-2*orbit(x, 57)-2*orbit(x, 52)-1*orbit(x, 48)-1*orbit(x, 40))/2;
-			orbit(x, 24) = (f_24-4*orbit(x, 65)-4*orbit(x, 62)-1*orbit(x, 59)-6*orbit(x, 56)-1*orbit(x, 51)-2*orbit(x, 45)-2*orbit(x, 39));
-			orbit(x, 23) = (f_23-1*orbit(x, 55)-1*orbit(x, 42)-2*orbit(x, 33))/4;
-			orbit(x, 22) = (f_22-2*orbit(x, 54)-1*orbit(x, 40)-1*orbit(x, 39)-1*orbit(x, 32)-2*orbit(x, 31))/3;
-			orbit(x, 21) = (f_21-3*orbit(x, 55)-3*orbit(x, 50)-2*orbit(x, 42)-2*orbit(x, 38)-2*orbit(x, 33));
-			orbit(x, 20) = (f_20-2*orbit(x, 54)-2*orbit(x, 49)-1*orbit(x, 40)-1*orbit(x, 37)-1*orbit(x, 32));
-			orbit(x, 19) = (f_19-4*orbit(x, 54)-4*orbit(x, 49)-1*orbit(x, 40)-2*orbit(x, 39)-1*orbit(x, 37)-2*orbit(x, 35)-2*orbit(x, 31));
-			orbit(x, 18) = (f_18-1*orbit(x, 59)-1*orbit(x, 51)-2*orbit(x, 46)-2*orbit(x, 45)-2*orbit(x, 36)-2*orbit(x, 27)-1*orbit(x, 24))/2;
-			orbit(x, 17) = (f_17-1*orbit(x, 60)-1*orbit(x, 53)-1*orbit(x, 51)-1*orbit(x, 48)-1*orbit(x, 37)-2*orbit(x, 34)-2*orbit(x, 30))/2;
-			orbit(x, 16) = (f_16-1*orbit(x, 59)-2*orbit(x, 52)-1*orbit(x, 51)-2*orbit(x, 46)-2*orbit(x, 36)-2*orbit(x, 34)-1*orbit(x, 29));
-			orbit(x, 15) = (f_15-1*orbit(x, 59)-2*orbit(x, 52)-1*orbit(x, 51)-2*orbit(x, 45)-2*orbit(x, 35)-2*orbit(x, 34)-2*orbit(x, 27));
+			o[72] = C5[x];
+			o[71] = (f_71-12*o[72])/2;
+			o[70] = (f_70-4*o[72]);
+			o[69] = (f_69-2*o[71])/4;
+			o[68] = (f_68-2*o[71]);
+			o[67] = (f_67-12*o[72]-4*o[71]);
+			o[66] = (f_66-12*o[72]-2*o[71]-3*o[70]);
+			o[65] = (f_65-3*o[70])/2;
+			o[64] = (f_64-2*o[71]-4*o[69]-1*o[68]);
+			o[63] = (f_63-3*o[70]-2*o[68]);
+			o[62] = (f_62-1*o[68])/2;
+			o[61] = (f_61-4*o[71]-8*o[69]-2*o[67])/2;
+			o[60] = (f_60-4*o[71]-2*o[68]-2*o[67]);
+			o[59] = (f_59-6*o[70]-2*o[68]-4*o[65]);
+			o[58] = (f_58-4*o[72]-2*o[71]-1*o[67]);
+			o[57] = (f_57-12*o[72]-4*o[71]-3*o[70]-1*o[67]-2*o[66]);
+			o[56] = (f_56-2*o[65])/3;
+			o[55] = (f_55-2*o[71]-2*o[67])/3;
+			o[54] = (f_54-3*o[70]-1*o[66]-2*o[65])/2;
+			o[53] = (f_53-2*o[68]-2*o[64]-2*o[63]);
+			o[52] = (f_52-2*o[66]-2*o[64]-1*o[59])/2;
+			o[51] = (f_51-2*o[68]-2*o[63]-4*o[62]);
+			o[50] = (f_50-1*o[68]-2*o[63])/3;
+			o[49] = (f_49-1*o[68]-1*o[64]-2*o[62])/2;
+			o[48] = (f_48-4*o[71]-8*o[69]-2*o[68]-2*o[67]-2*o[64]-2*o[61]-1*o[60]);
+			o[47] = (f_47-3*o[70]-2*o[68]-1*o[66]-1*o[63]-1*o[60]);
+			o[46] = (f_46-3*o[70]-2*o[68]-2*o[65]-1*o[63]-1*o[59]);
+			o[45] = (f_45-2*o[65]-2*o[62]-3*o[56]);
+			o[44] = (f_44-1*o[67]-2*o[61])/4;
+			o[43] = (f_43-2*o[66]-1*o[60]-1*o[59])/2;
+			o[42] = (f_42-2*o[71]-4*o[69]-2*o[67]-2*o[61]-3*o[55]);
+			o[41] = (f_41-2*o[71]-1*o[68]-2*o[67]-1*o[60]-3*o[55]);
+			o[40] = (f_40-6*o[70]-2*o[68]-2*o[66]-4*o[65]-1*o[60]-1*o[59]-4*o[54]);
+			o[39] = (f_39-4*o[65]-1*o[59]-6*o[56])/2;
+			o[38] = (f_38-1*o[68]-1*o[64]-2*o[63]-1*o[53]-3*o[50]);
+			o[37] = (f_37-2*o[68]-2*o[64]-2*o[63]-4*o[62]-1*o[53]-1*o[51]-4*o[49]);
+			o[36] = (f_36-1*o[68]-2*o[63]-2*o[62]-1*o[51]-3*o[50]);
+			o[35] = (f_35-1*o[59]-2*o[52]-2*o[45])/2;
+			o[34] = (f_34-1*o[59]-2*o[52]-1*o[51])/2;
+			o[33] = (f_33-1*o[67]-2*o[61]-3*o[58]-4*o[44]-2*o[42])/2;
+			o[32] = (f_32-2*o[66]-1*o[60]-1*o[59]-2*o[57]-2*o[43]-2*o[41]-1*o[40])/2;
+			o[31] = (f_31-2*o[65]-1*o[59]-3*o[56]-1*o[43]-2*o[39]);
+			o[30] = (f_30-1*o[67]-1*o[63]-2*o[61]-1*o[53]-4*o[44]);
+			o[29] = (f_29-2*o[66]-2*o[64]-1*o[60]-1*o[59]-1*o[53]-2*o[52]-2*o[43]);
+			o[28] = (f_28-2*o[65]-2*o[62]-1*o[59]-1*o[51]-1*o[43]);
+			o[27] = (f_27-1*o[59]-1*o[51]-2*o[45])/2;
+			o[26] = (f_26-2*o[67]-2*o[63]-2*o[61]-6*o[58]-1*o[53]-2*o[47]-2*o[42]);
+			o[25] = (f_25-2*o[66]-2*o[64]-1*o[59]-2*o[57]-2*o[52]-1*o[48]-1*o[40])/2;
+			o[24] = (f_24-4*o[65]-4*o[62]-1*o[59]-6*o[56]-1*o[51]-2*o[45]-2*o[39]);
+			o[23] = (f_23-1*o[55]-1*o[42]-2*o[33])/4;
+			o[22] = (f_22-2*o[54]-1*o[40]-1*o[39]-1*o[32]-2*o[31])/3;
+			o[21] = (f_21-3*o[55]-3*o[50]-2*o[42]-2*o[38]-2*o[33]);
+			o[20] = (f_20-2*o[54]-2*o[49]-1*o[40]-1*o[37]-1*o[32]);
+			o[19] = (f_19-4*o[54]-4*o[49]-1*o[40]-2*o[39]-1*o[37]-2*o[35]-2*o[31]);
+			o[18] = (f_18-1*o[59]-1*o[51]-2*o[46]-2*o[45]-2*o[36]-2*o[27]-1*o[24])/2;
+			o[17] = (f_17-1*o[60]-1*o[53]-1*o[51]-1*o[48]-1*o[37]-2*o[34]-2*o[30])/2;
+			o[16] = (f_16-1*o[59]-2*o[52]-1*o[51]-2*o[46]-2*o[36]-2*o[34]-1*o[29]);
+			o[15] = (f_15-1*o[59]-2*o[52]-1*o[51]-2*o[45]-2*o[35]-2*o[34]-2*o[27]);
+			emit(x, w, o);
+
+			while (!two_hop_expiry.empty() && two_hop_expiry.top().first <= x) {
+				int a = two_hop_expiry.top().second;
+				two_hop_bytes -= two_hop[a].size() * sizeof(std::pair<int,int>);
+				two_hop.erase(a);
+				two_hop_expiry.pop();
+			}
+		}, threads);
+	}
+
+	void Orca::precomputeCommon() {
+		common2.clear();
+		common3.clear();
+		has_common2 = has_common3 = false;
+
+		// Tables are filled until the budget is reached. If it is exceeded
+		// the table is dropped and its counts are computed on demand instead.
+		size_t budget_left = std::numeric_limits<size_t>::max();
+		if(memory_budget > 0) {
+			size_t used = memoryUsage().total();
+			budget_left = (memory_budget > used ? memory_budget - used : 0);
+		}
+
+		size_t max2 = budget_left / entry_bytes<decltype(common2)>();
+		has_common2 = true;
+		for (int x = 0; x < n && has_common2; x++) {
+			for (int n1 = 0; n1 < deg[x]; n1++) {
+				int a = adj[x][n1];
+				for (int n2 = n1+1; n2<deg[x]; n2++) {
+					int b = adj[x][n2];
+					common2[Pair(a,b)]++;
+				}
+				if (common2.size() > max2) {
+					std::unordered_map<Pair, int, HashPair>().swap(common2);
+					has_common2 = false;
+					break;
+				}
+			}
+		}
+
+		budget_left -= std::min(budget_left, table_bytes(common2));
+		size_t max3 = budget_left / entry_bytes<decltype(common3)>();
+		has_common3 = true;
+		for (int x = 0; x < n && has_common3; x++) {
+			for (int n1 = 0; n1 < deg[x]; n1++) {
+				int a = adj[x][n1];
+				for (int n2 = n1+1; n2<deg[x]; n2++) {
+					int b = adj[x][n2];
+					for (int n3 = n2+1; n3 < deg[x]; n3++) {
+						int c = adj[x][n3];
+						int st = adjacent(a,b)+adjacent(a,c)+adjacent(b,c);
+						if (st < 2) continue;
+						common3[Triple(a,b,c)]++;
+					}
+				}
+				if (common3.size() > max3) {
+					std::unordered_map<Triple, int, HashTriple>().swap(common3);
+					has_common3 = false;
+					break;
+				}
+			}
 		}
 	}
 
 	bool Orca::adjacent(int x, int y) const {
-		return std::binary_search(adj[x].begin(), adj[x].end(), y);
+		Row<int> row = adj[x];
+		return std::binary_search(row.begin(), row.end(), y);
 	}
 
 	int Orca::common3_get(int a, int b, int c) const {
+		if(!has_common3) {
+			// count nodes adjacent to all of a, b and c
+			Row<int> ra = adj[a], rb = adj[b], rc = adj[c];
+			if(rb.size() < ra.size()) std::swap(ra, rb);
+			if(rc.size() < ra.size()) std::swap(ra, rc);
+			int count = 0;
+			for(int v : ra) {
+				if(std::binary_search(rb.begin(), rb.end(), v)
+				&& std::binary_search(rc.begin(), rc.end(), v)) count++;
+			}
+			return count;
+		}
 		std::unordered_map<Triple, int, HashTriple>::const_iterator it = common3.find(Triple(a, b, c));
 		return (it != common3.end() ? it->second : 0);
 	}
 
 	int Orca::common2_get(int a, int b) const {
+		if(!has_common2) {
+			// count nodes adjacent to both a and b
+			Row<int> ra = adj[a], rb = adj[b];
+			int count = 0;
+			for(size_t i = 0, j = 0; i < ra.size() && j < rb.size(); ) {
+				if(ra[i] == rb[j]) { count++; i++; j++; }
+				else if(ra[i] < rb[j]) i++;
+				else j++;
+			}
+			return count;
+		}
 		std::unordered_map<Pair, int, HashPair>::const_iterator it = common2.find(Pair(a, b));
 		return (it != common2.end() ? it->second : 0);
 	}
@@ -640,4 +1034,32 @@ namespace orca {
 	int Orca::graphletSize() const {
 		return graphlet_size;
 	}
+
+	MemoryUsage Orca::memoryUsage() const {
+		MemoryUsage usage;
+		usage.degrees = deg.capacity() * sizeof(int);
+		usage.adjacency = adj_offsets.capacity() * sizeof(size_t)
+			+ adj_neighbours.capacity() * sizeof(int);
+		usage.edge_ids = edge_ids.capacity() * sizeof(int);
+		usage.orbits = orbit.data().size() * sizeof(int64_t);
+		usage.common2 = table_bytes(common2);
+		usage.common3 = table_bytes(common3);
+		return usage;
+	}
+
+	void Orca::setMemoryBudget(size_t bytes) {
+		memory_budget = bytes;
+	}
+
+	size_t Orca::memoryBudget() const {
+		return memory_budget;
+	}
+
+	void Orca::setCacheBudget(size_t bytes) {
+		cache_budget = bytes;
+	}
+
+	void Orca::setThreads(unsigned int threads) {
+		this->threads = threads;
+	}
 }